@@ -1,160 +1,763 @@
 #include <crow.h>
-#include <nlohmann/json.hpp>
+#include <pthread.h>
 
+#include <csignal>
+
+#include <atomic>
 #include <chrono>
-#include <iostream>
 #include <string>
 #include <memory>
 #include <set>
 #include <optional>
+#include <thread>
 
 #include "config.h"
 #include "audio.h"
+#include "hash.h"
+#include "logger.h"
 #include "recognizer.h"
+#include "resource_usage.h"
+#include "response.h"
+#include "result_cache.h"
+#include "settings.h"
 #include "task_manager.h"
+#include "trace.h"
+#include "metrics.h"
 #include "middlewares.h"
+#include "mock_recognizer.h"
 #include "sherpa-onnx/c-api/cxx-api.h"
 
-using json = nlohmann::json;
 using sherpa_onnx::cxx::OfflineRecognizer;
-using sherpa_onnx::cxx::OfflineRecognizerConfig;
 using sherpa_onnx::cxx::OfflineRecognizerResult;
 using sherpa_onnx::cxx::OfflineStream;
-using std::cerr;
-using std::cout;
 using std::string;
 
-struct RoundedFloatVector {
-  std::vector<float> data;
-};
+enum class ModelState { kLoading, kWarmingUp, kReady, kFailed };
 
-void to_json(json &j, const RoundedFloatVector &rfv) {
-  j = json::array();
-  for (auto num : rfv.data) {
-    double rounded = static_cast<int>(num * 100 + (num >= 0 ? 0.5 : -0.5)) / 100.0;  // Round to 2 decimal places
-    j.push_back(rounded);
+static const char *ModelStateName(ModelState state) {
+  switch (state) {
+    case ModelState::kLoading:
+      return "loading";
+    case ModelState::kWarmingUp:
+      return "warming_up";
+    case ModelState::kReady:
+      return "ready";
+    case ModelState::kFailed:
+      return "failed";
   }
+  return "unknown";
 }
 
+// Tracks background model reloads triggered through the admin endpoint.
+struct ModelReloadState {
+  std::atomic<bool> in_progress{false};
+  std::atomic<uint32_t> generation{0};  // Number of successful reloads since startup
+};
+
 static std::set<string> NO_AUDIO_PUNCTUATION = {"!", "'", ",", ".", ";", "?", "~"};
 
-OfflineRecognizerConfig GetRecognizerConfig(const Config &config) {
-  OfflineRecognizerConfig recognizer_config;
-  recognizer_config.model_config.sense_voice.model = config.get<string>("MODEL_WEIGHTS_LOCAL");
-  recognizer_config.model_config.sense_voice.use_itn = config.get<bool>("MODEL_USE_ITN");
-  recognizer_config.model_config.sense_voice.language = config.get<string>("MODEL_LANGUAGE");
-  recognizer_config.model_config.tokens = config.get<string>("MODEL_TOKENS_LOCAL");
-  recognizer_config.model_config.num_threads = config.get<int32_t>("MODEL_NUM_THREADS");
+// Identifies an upload together with the settings that affect its recognition result. `model_hint` is the model
+// the client asked for, the routed model follows from it, the clip length and `fast_model_max_duration` unless the
+// server is under pressure. The threshold is part of the key because it can be reloaded. `model_generation` counts
+// model reloads, so results of a replaced model are never served or shared.
+static uint64_t ContentKey(std::string_view file_data, const RecognitionOptions &options,
+                           std::optional<ModelVariant> model_hint, uint32_t model_generation,
+                           float fast_model_max_duration) {
+  const uint64_t hint = model_hint.has_value() ? 1 + static_cast<uint64_t>(*model_hint) : 0;
+  const uint64_t seed = (options.use_itn ? 1 : 0) | hint << 1 | static_cast<uint64_t>(model_generation) << 3;
+  const uint64_t routing = HashBytes(&fast_model_max_duration, sizeof(fast_model_max_duration), seed);
+  return HashBytes(file_data, HashBytes(options.language, routing));
+}
+
+// Second hash of an upload for the result cache, independent of ContentKey through its fixed seed. A cached
+// response is only returned when this matches too, so a 64-bit key collision is a miss.
+static uint64_t ContentCheck(std::string_view file_data) {
+  constexpr uint64_t CONTENT_CHECK_SEED = 0x9e3779b97f4a7c15;
+  return HashBytes(file_data, CONTENT_CHECK_SEED);
+}
+
+// Parses the `model` request field: "fast", "accurate", or "auto" to let the server route. Returns false for
+// anything else.
+static bool ParseModelHint(const std::string &value, std::optional<ModelVariant> &hint) {
+  if (value == "auto") {
+    hint.reset();
+  } else if (value == "fast") {
+    hint = ModelVariant::kFast;
+  } else if (value == "accurate") {
+    hint = ModelVariant::kDefault;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Requests are rejected once the queue reaches this size. With a fast model loaded, requests beyond
+// MAX_QUEUE_CAPACITY are still accepted up to FAST_MODEL_OVERFLOW_CAPACITY more and degraded to the fast model.
+static size_t QueueLimit(const Settings &settings) {
+  if (!settings.fast_model) return settings.max_queue_capacity;
+  return settings.max_queue_capacity + settings.fast_model_overflow_capacity;
+}
+
+struct ModelRoute {
+  ModelVariant model = ModelVariant::kDefault;
+  bool degraded = false;  // Routed to the fast model because of queue pressure, so the result is not cached
+};
+
+// Picks the model for a decoded clip. Overload always degrades to the fast model, otherwise an explicit hint wins,
+// clips shorter than FAST_MODEL_MAX_DURATION seconds go to the fast model, and so does everything once the queue
+// holds FAST_MODEL_QUEUE_THRESHOLD tasks.
+static ModelRoute RouteModel(std::optional<ModelVariant> hint, float duration, size_t queue_size,
+                             const Settings &settings) {
+  if (!settings.fast_model) return {};
+
+  if (queue_size >= settings.max_queue_capacity) return {ModelVariant::kFast, true};
+  if (hint.has_value()) return {*hint, false};
+  if (duration < settings.fast_model_max_duration) return {ModelVariant::kFast, false};
+  if (queue_size >= settings.fast_model_queue_threshold) return {ModelVariant::kFast, true};
+  return {};
+}
+
+static std::optional<bool> ParseBool(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+  if (value == "1" || value == "true" || value == "yes" || value == "on") return true;
+  if (value == "0" || value == "false" || value == "no" || value == "off") return false;
+  return std::nullopt;
+}
+
+// A parsed /asr request, independent of whether it came in as multipart form or raw body.
+struct AsrRequest {
+  uint64_t id = 0;                // Returned in the X-Request-Id header and attached to log lines
+  uint32_t model_generation = 0;  // Model reloads when the request arrived, part of its cache key
+  uint64_t content_check = 0;     // ContentCheck of the upload, stored with its cached response
+  std::string_view file_data;
+  RecognitionOptions options;
+  std::optional<ModelVariant> model_hint;
+  bool include_timings = false;  // Add the `timings` field to the response body
+  std::chrono::steady_clock::time_point begin;
+  StageTimings timings;
+};
+
+// Records the total request time and sets the Server-Timing and X-Request-Id headers of an /asr response.
+static crow::response WithTimings(crow::response response, AsrRequest &request) {
+  const auto end = std::chrono::steady_clock::now();
+  request.timings.total = end - request.begin;
+  TraceSpan("request", request.begin, end, request.id);
+  response.set_header("Server-Timing", ServerTimingHeader(request.timings));
+  response.set_header("X-Request-Id", std::to_string(request.id));
+  return response;
+}
+
+// Waits for a recognition task and builds the /asr JSON response, storing successful responses in the result
+// cache under `cache_key` if one is given. `duration` is the clip length in seconds, or 0 when the request was
+// coalesced onto another one and never decoded; only the request that submitted the task records its queue wait.
+static crow::response RespondWithResult(const std::shared_future<RecognitionResult> &future,
+                                        ResultCache &result_cache, Metrics &metrics,
+                                        std::optional<uint64_t> cache_key, const Settings &settings, float duration,
+                                        AsrRequest &request) {
+  if (future.wait_for(settings.max_processing_time) != std::future_status::ready) {
+    metrics.timed_out.add();
+    return WithTimings(crow::response(504, "Timeout while processing"), request);
+  }
+
+  // The result may be shared with coalesced requests, so it is only read here
+  const auto &recognition = future.get();
+  const auto &asr_result = recognition.result;
+  if (duration > 0) {
+    metrics.queue_wait_seconds.observe(std::chrono::duration<double>(recognition.queue_wait).count());
+  }
+  request.timings.queue = recognition.queue_wait;
+  request.timings.infer = recognition.inference;
+
+  const auto serialize_begin = std::chrono::steady_clock::now();
+  auto is_no_audio = std::all_of(asr_result.tokens.begin(), asr_result.tokens.end(),
+                                 [](const std::string &token) { return NO_AUDIO_PUNCTUATION.count(token) > 0; });
+  auto body = SerializeResult(asr_result, is_no_audio);
+  const auto serialize_end = std::chrono::steady_clock::now();
+  request.timings.serialize = serialize_end - serialize_begin;
+  TraceSpan("serialize", serialize_begin, serialize_end, request.id);
+
+  if (cache_key.has_value()) {
+    result_cache.put(*cache_key, request.content_check, body);
+  }
+
+  auto response = WithTimings(crow::response(200), request);
+  const auto &timings = request.timings;
+  if (duration > 0) {
+    const double rtf = std::chrono::duration<double>(timings.total).count() / duration;
+    LogInfo("Timings (ms): parse %.1f, decode %.1f, queue %.1f, infer %.1f, serialize %.2f, total %.1f; RTF %.3f",
+            Milliseconds(timings.parse), Milliseconds(timings.decode), Milliseconds(timings.queue),
+            Milliseconds(timings.infer), Milliseconds(timings.serialize), Milliseconds(timings.total), rtf);
+  }
+  // Cached bodies never contain timings, so requests that ask for them get a second serialization
+  response.body = request.include_timings ? SerializeResult(asr_result, is_no_audio, &timings) : std::move(body);
+  return response;
+}
+
+// Wraps a loaded recognizer as a task function, or returns an empty one for null.
+static RecognitionTaskFn RecognizerFn(std::shared_ptr<Recognizer> recognizer) {
+  if (!recognizer) return nullptr;
+  return [recognizer](const std::vector<AudioData> &waves, const RecognitionOptions &options) {
+    return recognizer->RecognizeBatch(waves, options);
+  };
+}
+
+// Dispatches each batch to the backend of its model variant and records its size, audio length and inference
+// time. `recognize_fast` is empty when no fast model is configured, in which case routing never picks it.
+static RecognitionTaskFn MakeProcessor(RecognitionTaskFn recognize, RecognitionTaskFn recognize_fast,
+                                       std::shared_ptr<Metrics> metrics) {
+  return [recognize, recognize_fast, metrics](const std::vector<AudioData> &waves,
+                                              const RecognitionOptions &options) {
+    const auto begin = std::chrono::steady_clock::now();
+    auto results = options.model == ModelVariant::kFast && recognize_fast ? recognize_fast(waves, options)
+                                                                          : recognize(waves, options);
+    const auto end = std::chrono::steady_clock::now();
+
+    uint64_t audio_ms = 0;
+    for (const auto &wave : waves) {
+      audio_ms += wave.samples.size() * 1000 / static_cast<uint64_t>(wave.sample_rate);
+    }
+    metrics->audio_ms.add(audio_ms);
+    metrics->batch_size.observe(waves.size());
+    metrics->inference_seconds.observe(std::chrono::duration<double>(end - begin).count());
+    return results;
+  };
+}
+
+// The result a silent clip is answered with, shaped like the model's results so both no_audio answers carry the same
+// fields: the requested language, or SenseVoice's `nospeech` label for auto, and its unknown emotion and event labels.
+static OfflineRecognizerResult SilentResult(const RecognitionOptions &options) {
+  OfflineRecognizerResult result;
+  result.lang = "<|" + (options.language == "auto" ? std::string("nospeech") : options.language) + "|>";
+  result.emotion = "<|EMO_UNKNOWN|>";
+  result.event = "<|Event_UNK|>";
+  return result;
+}
+
+// Runs the SILENCE_DETECTION check on a decoded clip and counts it if it is skipped. Silent clips are answered with
+// the no_audio response right away instead of spending a model decode on punctuation-only tokens.
+static bool SkipSilentClip(const AudioData &wave, float duration, Metrics &metrics, const Settings &settings) {
+  if (!settings.silence_detection) return false;
+  if (!IsSilent(wave, settings.silence_threshold_dbfs, settings.silence_min_voiced_seconds)) return false;
+  metrics.silent_skipped.add();
+  metrics.silent_audio_ms.add(static_cast<uint64_t>(duration * 1000));
+  return true;
+}
+
+// Builds and warms up new recognizers from the current model files, then swaps them into the task manager.
+// The previous recognizers are freed once the tasks still running on it complete. Any failure, including an invalid
+// value in .env, is logged and keeps the current model.
+static void ReloadModel(const std::shared_ptr<RecognitionTaskManager> task_manager,
+                        const std::shared_ptr<ResultCache> result_cache,
+                        const std::shared_ptr<Metrics> metrics,
+                        const std::shared_ptr<ModelReloadState> reload_state,
+                        const std::shared_ptr<SettingsStore> settings_store, const Config &config) {
+  const auto begin = std::chrono::steady_clock::now();
+
+  try {
+    const auto &settings = settings_store->get();
+    auto recognizer = std::make_shared<Recognizer>(GetRecognizerConfig(config), settings.model_options);
+    std::shared_ptr<Recognizer> fast_recognizer;
+    if (settings.fast_model) {
+      fast_recognizer =
+        std::make_shared<Recognizer>(GetRecognizerConfig(config, ModelVariant::kFast), settings.model_options);
+    }
+    if (!recognizer->Init() || (fast_recognizer && !fast_recognizer->Init())) {
+      LogError("Model reload failed, keeping the current model.");
+    } else {
+      if (config.get<bool>("MODEL_WARMUP", true)) {
+        recognizer->Warmup(task_manager->getWorkerCount());
+        if (fast_recognizer) fast_recognizer->Warmup(task_manager->getWorkerCount());
+      }
+
+      task_manager->setProcessor(MakeProcessor(RecognizerFn(recognizer), RecognizerFn(fast_recognizer), metrics));
+      // Requests from now on use the new generation in their cache keys, so results of tasks still finishing on the
+      // previous model are stored under keys that are never looked up again and age out of the cache
+      ++reload_state->generation;
+      result_cache->clear();
+
+      const auto end = std::chrono::steady_clock::now();
+      const float elapsed_seconds =
+        std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() / 1000.;
+      LogInfo("Model reloaded in %.3fs", elapsed_seconds);
+    }
+  } catch (const std::exception &e) {
+    LogError("Model reload failed, keeping the current model: %s", e.what());
+  }
+
+  reload_state->in_progress = false;
+}
+
+// Re-reads .env and the environment and applies the settings that can change without a restart: queue capacity and
+// thresholds, timeouts, routing and silence detection, the worker count, the batch size, the result cache
+// capacity, the log level and tracing. Model files and the listen address are left as they are, the fast model and
+// the loaded languages can only be changed at startup.
+// Throws std::invalid_argument and keeps the current settings if a new value is invalid.
+static void ReloadSettings(Config &config, SettingsStore &settings_store, RecognitionTaskManager &task_manager,
+                           ResultCache &result_cache) {
+  static std::mutex reload_mutex;
+  std::lock_guard<std::mutex> lock(reload_mutex);
+
+  config.reload();
+  auto settings = Settings::FromConfig(config);
+  const auto &current = settings_store.get();
+  settings.fast_model = current.fast_model;
+  settings.model_options = current.model_options;
+  if (!settings.isLoaded(settings.default_options)) {
+    throw std::invalid_argument("Invalid MODEL_LANGUAGE: no model is loaded for it, changing MODEL_LANGUAGES needs a "
+                                "restart");
+  }
+
+  if (settings.num_workers != current.num_workers) {
+    task_manager.setWorkerCount(settings.num_workers);
+  }
+  task_manager.setMaxBatchSize(settings.max_batch_size);
+  result_cache.setCapacity(settings.result_cache_max_bytes);
+  settings_store.update(std::move(settings));
+
+  const auto &updated = settings_store.get();
+  SetLogLevel(updated.log_level);
+  SetTracing(updated.trace_enabled);
+  LogInfo("Settings reloaded: %zu worker(s), batch size %zu, queue capacity %zu", updated.num_workers,
+          updated.max_batch_size, updated.max_queue_capacity);
+}
+
+// Runs a parsed /asr request: result cache, coalescing onto identical in-flight uploads, admission, decoding with
+// `decode`, the silence check, model routing and the wait for the result.
+template <typename DecodeFn>
+static crow::response HandleAsrRequest(AsrRequest &request, DecodeFn decode, RecognitionTaskManager &task_manager,
+                                       ResultCache &result_cache, Metrics &metrics, const Settings &settings) {
+  const auto parse_end = std::chrono::steady_clock::now();
+  request.timings.parse = parse_end - request.begin;
+  TraceSpan("parse", request.begin, parse_end, request.id);
+
+  const auto cache_key = ContentKey(request.file_data, request.options, request.model_hint, request.model_generation,
+                                    settings.fast_model_max_duration);
+  request.content_check = ContentCheck(request.file_data);
+  if (auto cached = result_cache.get(cache_key, request.content_check)) {
+    auto response = WithTimings(crow::response(200), request);
+    response.body = std::move(*cached);
+    // Cached bodies never contain timings, so they are spliced in for requests that ask for them
+    if (request.include_timings) InsertTimings(response.body, request.timings);
+    return response;
+  }
+
+  // Identical content that is already queued or running shares that task's result
+  if (auto pending = task_manager.findTask(cache_key)) {
+    return RespondWithResult(*pending, result_cache, metrics, cache_key, settings, 0, request);
+  }
 
-  return recognizer_config;
+  if (task_manager.getQueueSize() >= QueueLimit(settings)) {
+    metrics.rejected.add();
+    return WithTimings(crow::response(503, "Server is busy, please try again later."), request);
+  }
+
+  const auto decode_begin = std::chrono::steady_clock::now();
+  AudioData wave = decode(request.file_data);
+  const auto decode_end = std::chrono::steady_clock::now();
+  request.timings.decode = decode_end - decode_begin;
+  TraceSpan("decode", decode_begin, decode_end, request.id);
+  metrics.decode_seconds.observe(std::chrono::duration<double>(request.timings.decode).count());
+  if (!wave.isValid()) {
+    return WithTimings(crow::response(400, "Failed to read audio file."), request);
+  }
+
+  float duration = wave.samples.size() / static_cast<float>(wave.sample_rate);
+  if (SkipSilentClip(wave, duration, metrics, settings)) {
+    auto response = WithTimings(crow::response(200), request);
+    response.body =
+      SerializeResult(SilentResult(request.options), true, request.include_timings ? &request.timings : nullptr);
+    return response;
+  }
+
+  const auto route = RouteModel(request.model_hint, duration, task_manager.getQueueSize(), settings);
+  request.options.model = route.model;
+  // Degraded results depend on the load at the time, so they are neither shared with later requests nor cached
+  const auto task_key = route.degraded ? std::nullopt : std::optional<uint64_t>(cache_key);
+  const auto enqueue_begin = std::chrono::steady_clock::now();
+  auto future = task_manager.submitTask(std::move(wave), request.options, 0, task_key);
+  TraceSpan("enqueue", enqueue_begin, std::chrono::steady_clock::now(), request.id);
+  return RespondWithResult(future, result_cache, metrics, task_key, settings, duration, request);
 }
 
-crow::App<BearerAuthMiddleware> SetupCrow(const std::shared_ptr<RecognitionTaskManager> task_manager,
-                                          const Config &config) {
+crow::App<MetricsMiddleware, BearerAuthMiddleware> SetupCrow(
+  const std::shared_ptr<RecognitionTaskManager> task_manager, const std::shared_ptr<ResultCache> result_cache,
+  const std::shared_ptr<Metrics> metrics, const std::shared_ptr<std::atomic<ModelState>> model_state,
+  const std::shared_ptr<ModelReloadState> reload_state, const std::shared_ptr<SettingsStore> settings_store,
+  Config &config) {
   std::optional<std::string> bearer_token = std::nullopt;
   if (config.has("BEARER_TOKEN")) {
     bearer_token.emplace(config.get<std::string>("BEARER_TOKEN"));
   }
   BearerAuthMiddleware bearer_auth_middleware(bearer_token);
+  // Listed first so that it also counts requests rejected by the authentication middleware
+  MetricsMiddleware metrics_middleware(metrics.get());
 
-  crow::App<BearerAuthMiddleware> app(bearer_auth_middleware);
+  crow::App<MetricsMiddleware, BearerAuthMiddleware> app(metrics_middleware, bearer_auth_middleware);
+
+  // Liveness: the process is up and the model has not failed to load.
+  CROW_ROUTE(app, "/health/live")
+  ([model_state]() {
+    const bool alive = model_state->load() != ModelState::kFailed;
+    crow::json::wvalue res;
+    res["status"] = alive ? "ok" : "failed";
+    crow::response response(alive ? 200 : 503, res.dump());
+    response.set_header("Content-Type", "application/json");
+    return response;
+  });
+
+  // Readiness: the model is loaded and warmed up, the queue is below the shed threshold and the worker is not stuck.
+  CROW_ROUTE(app, "/health/ready")
+  ([task_manager, model_state, settings_store]() {
+    const auto &settings = settings_store->get();
+    const auto state = model_state->load();
+    const auto queue_size = task_manager->getQueueSize();
+    const auto queue_threshold = settings.readiness_queue_threshold;
+    const bool model_ready = state == ModelState::kReady;
+    const bool queue_ok = queue_size < queue_threshold;
+    const bool worker_ok = task_manager->isHealthy(settings.worker_stall_timeout);
+    const bool ready = model_ready && queue_ok && worker_ok;
+
+    crow::json::wvalue res;
+    res["status"] = ready ? "ready" : "not_ready";
+    res["model"] = ModelStateName(state);
+    res["queue_size"] = queue_size;
+    res["queue_threshold"] = queue_threshold;
+    res["worker_healthy"] = worker_ok;
+    crow::response response(ready ? 200 : 503, res.dump());
+    response.set_header("Content-Type", "application/json");
+    return response;
+  });
 
   CROW_ROUTE(app, "/health")
-  ([task_manager]() {
+  ([task_manager, result_cache, metrics, model_state, reload_state]() {
     crow::json::wvalue res;
     res["status"] = "ok";
+    res["model"] = ModelStateName(model_state->load());
+    res["model_generation"] = reload_state->generation.load();
     res["queue_size"] = task_manager->getQueueSize();
+
+    auto cache_stats = result_cache->getStats();
+    res["result_cache"]["hits"] = cache_stats.hits;
+    res["result_cache"]["misses"] = cache_stats.misses;
+    res["result_cache"]["evictions"] = cache_stats.evictions;
+    res["result_cache"]["entries"] = cache_stats.entries;
+    res["result_cache"]["bytes"] = cache_stats.bytes;
+    res["result_cache"]["capacity_bytes"] = cache_stats.capacity_bytes;
+
+    res["silence"]["skipped"] = metrics->silent_skipped.value();
+    res["silence"]["skipped_audio_seconds"] = metrics->silent_audio_ms.value() / 1000.0;
+    res["silence"]["inference_seconds_saved"] = metrics->estimatedSecondsSaved();
     return res;
   });
 
-  CROW_ROUTE(app, "/asr").methods("POST"_method)([task_manager, &config](const crow::request &req) {
+  // Prometheus scrape endpoint.
+  CROW_ROUTE(app, "/metrics")
+  ([task_manager, result_cache, metrics, model_state, reload_state]() {
+    std::string body;
+    body.reserve(8192);
+    metrics->render(body);
+
+    const auto cache_stats = result_cache->getStats();
+    RenderGauge(body, "asr_queue_size", "Tasks waiting in the queue.", task_manager->getQueueSize());
+    RenderGauge(body, "asr_workers", "Recognition worker threads.", task_manager->getWorkerCount());
+    RenderGauge(body, "asr_model_ready", "Whether the model is loaded and warmed up.",
+                model_state->load() == ModelState::kReady ? 1 : 0);
+    RenderGauge(body, "asr_model_generation", "Successful model reloads since startup.",
+                reload_state->generation.load());
+    RenderCounter(body, "asr_result_cache_hits_total", "Result cache hits.", cache_stats.hits);
+    RenderCounter(body, "asr_result_cache_misses_total", "Result cache misses.", cache_stats.misses);
+    RenderGauge(body, "asr_result_cache_bytes", "Memory used by cached responses.", cache_stats.bytes);
+
+    crow::response response(200, std::move(body));
+    response.set_header("Content-Type", "text/plain; version=0.0.4");
+    return response;
+  });
+
+  CROW_ROUTE(app, "/asr").methods("POST"_method)([task_manager, result_cache, metrics, model_state, reload_state,
+                                                  settings_store](const crow::request &req) {
     const auto begin = std::chrono::steady_clock::now();
+    const auto &settings = settings_store->get();
+    const uint64_t request_id = NextRequestId();
+    LogRequestScope log_scope(request_id);
+    SetTraceThreadName("http");
 
-    if (task_manager->getQueueSize() >= config.get<int32_t>("MAX_QUEUE_CAPACITY")) {
-      return crow::response(503, "Server is busy, please try again later.");
+    if (model_state->load() != ModelState::kReady) {
+      return crow::response(503, "Model is not ready, please try again later.");
     }
 
     crow::multipart::mp_map part_map;
     try {
       crow::multipart::message multipart_req(req);
-      part_map = multipart_req.part_map;
+      part_map = std::move(multipart_req.part_map);
     } catch (const std::exception &e) {
       return crow::response(400, std::string("Multipart parse error: ") + e.what());
     }
 
-    std::string language = "auto";
-    std::vector<uint8_t> file_data;
+    AsrRequest request;
+    request.id = request_id;
+    request.begin = begin;
+    request.model_generation = reload_state->generation.load();
+    request.options = settings.default_options;
 
     for (auto &[key, part] : part_map) {
       if (key == "language" && !part.body.empty()) {
-        language = part.body;
+        request.options.language = part.body;
+      } else if (key == "use_itn" && !part.body.empty()) {
+        auto use_itn = ParseBool(part.body);
+        if (!use_itn.has_value()) {
+          return crow::response(400, "Invalid 'use_itn' field.");
+        }
+        request.options.use_itn = *use_itn;
+      } else if (key == "model" && !part.body.empty()) {
+        if (!ParseModelHint(part.body, request.model_hint)) {
+          return crow::response(400, "Invalid 'model' field.");
+        }
+      } else if (key == "timings" && !part.body.empty()) {
+        auto timings = ParseBool(part.body);
+        if (!timings.has_value()) {
+          return crow::response(400, "Invalid 'timings' field.");
+        }
+        request.include_timings = *timings;
       } else if (key == "file") {
-        file_data = std::vector<uint8_t>(part.body.begin(), part.body.end());
+        request.file_data = part.body;
       }
     }
 
-    if (file_data.empty()) {
+    if (request.file_data.empty()) {
       return crow::response(400, "Missing 'file' field.");
     }
-
-    auto wave = ReadAudio(file_data, config.get<int32_t>("AUDIO_RESAMPLE_RATE"));
-    if (!wave.isValid()) {
-      return crow::response(400, "Failed to read audio file.");
+    if (!IsSupportedLanguage(request.options.language)) {
+      return crow::response(400, "Unsupported language: " + request.options.language);
+    }
+    if (!settings.isLoaded(request.options)) {
+      return crow::response(400, "Language " + request.options.language + " with use_itn=" +
+                                   (request.options.use_itn ? "true" : "false") + " is not enabled on this server.");
     }
 
-    auto future = task_manager->submitTask(wave);
+    const auto resample_rate = settings.audio_resample_rate;
+    return HandleAsrRequest(
+      request, [resample_rate](std::string_view data) { return ReadAudio(data, resample_rate); }, *task_manager,
+      *result_cache, *metrics, settings);
+  });
+
+  // Raw-body variant of /asr: the request body is the audio file itself and options come from the query string,
+  // e.g. `POST /asr/raw?language=zh&use_itn=false&model=auto&timings=true`. This skips multipart parsing; the body is
+  // decoded in place once Crow has received all of it, since Crow does not hand out a body while it is arriving.
+  CROW_ROUTE(app, "/asr/raw").methods("POST"_method)([task_manager, result_cache, metrics, model_state,
+                                                      reload_state, settings_store](const crow::request &req) {
+    const auto begin = std::chrono::steady_clock::now();
+    const auto &settings = settings_store->get();
+    const uint64_t request_id = NextRequestId();
+    LogRequestScope log_scope(request_id);
+    SetTraceThreadName("http");
 
-    if (future.wait_for(std::chrono::seconds(config.get<int32_t>("MAX_PROCESSING_TIME"))) !=
-        std::future_status::ready) {
-      return crow::response(504, "Timeout while processing");
+    if (model_state->load() != ModelState::kReady) {
+      return crow::response(503, "Model is not ready, please try again later.");
     }
 
-    auto asr_result = future.get();
-    auto is_no_audio = std::all_of(asr_result.tokens.begin(), asr_result.tokens.end(),
-                                   [](const std::string &token) { return NO_AUDIO_PUNCTUATION.count(token) > 0; });
-    if (is_no_audio) {
-      asr_result.text = "";
-      asr_result.tokens.clear();
-      asr_result.timestamps.clear();
+    if (req.body.empty()) {
+      return crow::response(400, "Missing request body.");
     }
-    json result_json = {
-      {"status", is_no_audio ? "no_audio" : "normal"},
-      {"lang", asr_result.lang},
-      {"emotion", asr_result.emotion},
-      {"event", asr_result.event},
-      {"text", asr_result.text},
-      {"timestamps", RoundedFloatVector{asr_result.timestamps}},
-      {"tokens", asr_result.tokens},
-    };
 
-    const auto end = std::chrono::steady_clock::now();
-    const float elapsed_seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() / 1000.;
-    float duration = wave.samples.size() / static_cast<float>(wave.sample_rate);
-    float rtf = duration / elapsed_seconds;
-    cout << "RTF = " << duration << "s / " << elapsed_seconds << "s = " << rtf << "\n";
+    AsrRequest request;
+    request.id = request_id;
+    request.begin = begin;
+    request.model_generation = reload_state->generation.load();
+    request.file_data = req.body;
+    request.options = settings.default_options;
+    if (const char *value = req.url_params.get("language"); value != nullptr && *value != '\0') {
+      request.options.language = value;
+    }
+    if (const char *value = req.url_params.get("use_itn"); value != nullptr && *value != '\0') {
+      auto use_itn = ParseBool(value);
+      if (!use_itn.has_value()) {
+        return crow::response(400, "Invalid 'use_itn' parameter.");
+      }
+      request.options.use_itn = *use_itn;
+    }
+    if (const char *value = req.url_params.get("model"); value != nullptr && *value != '\0') {
+      if (!ParseModelHint(value, request.model_hint)) {
+        return crow::response(400, "Invalid 'model' parameter.");
+      }
+    }
+    if (const char *value = req.url_params.get("timings"); value != nullptr && *value != '\0') {
+      auto timings = ParseBool(value);
+      if (!timings.has_value()) {
+        return crow::response(400, "Invalid 'timings' parameter.");
+      }
+      request.include_timings = *timings;
+    }
+    if (!IsSupportedLanguage(request.options.language)) {
+      return crow::response(400, "Unsupported language: " + request.options.language);
+    }
+    if (!settings.isLoaded(request.options)) {
+      return crow::response(400, "Language " + request.options.language + " with use_itn=" +
+                                   (request.options.use_itn ? "true" : "false") + " is not enabled on this server.");
+    }
+
+    const auto resample_rate = settings.audio_resample_rate;
+    return HandleAsrRequest(
+      request, [resample_rate](std::string_view data) { return ReadAudio(data, resample_rate); }, *task_manager,
+      *result_cache, *metrics, settings);
+  });
+
+  // Reloads the model files in the background without dropping requests, e.g. after replacing model.int8.onnx.
+  CROW_ROUTE(app, "/admin/reload-model")
+    .methods("POST"_method)(
+      [task_manager, result_cache, metrics, model_state, reload_state, settings_store, &config]() {
+        if (model_state->load() != ModelState::kReady) {
+          return crow::response(409, "Model is not loaded yet.");
+        }
+        if (config.get<string>("RECOGNIZER_BACKEND", "onnx") == "mock") {
+          return crow::response(409, "The mock backend has no model to reload.");
+        }
+        if (reload_state->in_progress.exchange(true)) {
+          return crow::response(409, "A model reload is already in progress.");
+        }
 
-    return crow::response(200, result_json.dump());
+        std::thread(ReloadModel, task_manager, result_cache, metrics, reload_state, settings_store,
+                    std::cref(config))
+          .detach();
+        return crow::response(202, "Model reload started.");
+      });
+
+  // Spans recorded while TRACE_ENABLED is on, for chrome://tracing or ui.perfetto.dev.
+  CROW_ROUTE(app, "/admin/trace")
+  ([]() {
+    std::string body;
+    RenderTrace(body);
+    crow::response response(200, std::move(body));
+    response.set_header("Content-Type", "application/json");
+    return response;
   });
 
+  // Applies changed operational settings from .env without a restart, same as sending SIGHUP.
+  CROW_ROUTE(app, "/admin/reload-settings")
+    .methods("POST"_method)([task_manager, result_cache, settings_store, &config]() {
+      try {
+        ReloadSettings(config, *settings_store, *task_manager, *result_cache);
+      } catch (const std::exception &e) {
+        return crow::response(400, std::string("Settings not reloaded: ") + e.what());
+      }
+      return crow::response(200, "Settings reloaded.");
+    });
+
   return app;
 }
 
+// Loads and warms up the ONNX models, logging the memory they take. Returns false if a model fails to load.
+static bool LoadModels(Recognizer &recognizer, Recognizer *fast_recognizer, size_t num_workers, const Config &config,
+                       std::atomic<ModelState> &model_state) {
+  const int64_t rss_before_load = GetResidentSetBytes();
+  if (!recognizer.Init() || (fast_recognizer && !fast_recognizer->Init())) {
+    return false;
+  }
+  const int64_t rss_after_load = GetResidentSetBytes();
+  LogInfo("RSS: %lld MiB for model weights, peak %lld MiB during load",
+          static_cast<long long>((rss_after_load - rss_before_load) / (1 << 20)),
+          static_cast<long long>(GetPeakResidentSetBytes() / (1 << 20)));
+
+  if (config.get<bool>("MODEL_WARMUP", true)) {
+    model_state.store(ModelState::kWarmingUp);
+    recognizer.Warmup(num_workers);
+    if (fast_recognizer) fast_recognizer->Warmup(num_workers);
+
+    const int64_t rss_after_warmup = GetResidentSetBytes();
+    LogInfo("RSS: %lld MiB for activations of %zu worker(s), %lld MiB per worker",
+            static_cast<long long>((rss_after_warmup - rss_after_load) / (1 << 20)), num_workers,
+            static_cast<long long>((rss_after_warmup - rss_after_load) / num_workers / (1 << 20)));
+  }
+  return true;
+}
+
 int32_t main() {
   Config config;
 
-  auto recognizer_config = GetRecognizerConfig(config);
-  auto recognizer = std::make_shared<Recognizer>(recognizer_config);
-  if (!recognizer) {
-    cerr << "Failed to create recognizer with config.\n";
+  std::shared_ptr<SettingsStore> settings_store;
+  try {
+    settings_store = std::make_shared<SettingsStore>(Settings::FromConfig(config));
+  } catch (const std::exception &e) {
+    LogError("Invalid configuration: %s", e.what());
+    FlushLog();
+    return -1;
+  }
+  const auto &settings = settings_store->get();
+  SetLogLevel(settings.log_level);
+  SetTracing(settings.trace_enabled);
+
+  // Block SIGHUP before any thread starts, so that every thread inherits the mask and only the settings reload
+  // thread below receives it through sigwait()
+  sigset_t reload_signals;
+  sigemptyset(&reload_signals);
+  sigaddset(&reload_signals, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &reload_signals, nullptr);
+
+  // RECOGNIZER_BACKEND=mock replaces the models with simulated inference, see mock_recognizer.h
+  const auto backend = config.get<string>("RECOGNIZER_BACKEND", "onnx");
+  std::shared_ptr<Recognizer> recognizer;
+  std::shared_ptr<Recognizer> fast_recognizer;
+  RecognitionTaskFn recognize;
+  if (backend == "onnx") {
+    recognizer = std::make_shared<Recognizer>(GetRecognizerConfig(config), settings.model_options);
+    if (settings.fast_model) {
+      fast_recognizer =
+        std::make_shared<Recognizer>(GetRecognizerConfig(config, ModelVariant::kFast), settings.model_options);
+    }
+    recognize = RecognizerFn(recognizer);
+  } else if (backend == "mock") {
+    try {
+      recognize = MakeMockRecognizer(MockRecognizerConfig::FromConfig(config));
+    } catch (const std::exception &e) {
+      LogError("Invalid configuration: %s", e.what());
+      FlushLog();
+      return -1;
+    }
+    LogWarning("Using the mock recognizer backend, results are canned.");
+  } else {
+    LogError("Invalid configuration: RECOGNIZER_BACKEND must be onnx or mock");
+    FlushLog();
     return -1;
   }
-  recognizer->Init();
 
+  auto metrics = std::make_shared<Metrics>();
+
+  // All workers share one recognizer per model, and with it one copy of the model weights
+  const auto num_workers = settings.num_workers;
   auto task_manager = std::make_shared<RecognitionTaskManager>(
-    [recognizer](const AudioData &wave) { return recognizer->Recognize(wave); });
+    MakeProcessor(recognize, RecognizerFn(fast_recognizer), metrics), num_workers, settings.max_batch_size);
+
+  auto result_cache = std::make_shared<ResultCache>(settings.result_cache_max_bytes);
+  auto model_state = std::make_shared<std::atomic<ModelState>>(ModelState::kLoading);
+  auto reload_state = std::make_shared<ModelReloadState>();
+
+  // Reloads operational settings on SIGHUP, e.g. `kill -HUP <pid>` after editing .env
+  std::thread([reload_signals, settings_store, task_manager, result_cache, &config]() {
+    int signal = 0;
+    while (sigwait(&reload_signals, &signal) == 0) {
+      try {
+        ReloadSettings(config, *settings_store, *task_manager, *result_cache);
+      } catch (const std::exception &e) {
+        LogError("Settings not reloaded: %s", e.what());
+      }
+    }
+  }).detach();
+
+  // Start serving health checks right away, /health/ready turns green once the model is loaded and warmed up
+  auto app = SetupCrow(task_manager, result_cache, metrics, model_state, reload_state, settings_store, config);
+  auto server =
+    app.bindaddr(config.get<string>("WEB_HOST")).port(config.get<int32_t>("WEB_PORT")).multithreaded().run_async();
+  app.wait_for_server_start();
+
+  if (recognizer && !LoadModels(*recognizer, fast_recognizer.get(), num_workers, config, *model_state)) {
+    LogError("Failed to load model, shutting down.");
+    model_state->store(ModelState::kFailed);
+    app.stop();
+    FlushLog();
+    return -1;
+  }
+  model_state->store(ModelState::kReady);
 
-  auto app = SetupCrow(task_manager, config);
-  app.bindaddr(config.get<string>("WEB_HOST")).port(config.get<int32_t>("WEB_PORT")).multithreaded().run();
+  server.wait();
 
   return 0;
 }
@@ -1,19 +1,15 @@
 #define MINIAUDIO_IMPLEMENTATION  // Important: define this in exactly one .c or .cpp file
 #include "include/miniaudio.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <fstream>  // For example usage
 
 #include "audio.h"
+#include "logger.h"
 
-AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32_t> target_sample_rate) {
-  AudioData audio_data;
-
-  if (file_buffer.empty()) {
-    std::cerr << "Error: Input file buffer is empty." << std::endl;
-    return audio_data;  // Return empty data
-  }
-
+static ma_decoder_config MakeDecoderConfig(std::optional<int32_t> target_sample_rate,
+                                           std::optional<int32_t> target_channels) {
   ma_decoder_config decoder_config = ma_decoder_config_init(ma_format_f32,  // We want output as float32
                                                             0,              // Channels (0 means auto-detect from file)
                                                             0  // Sample rate (0 means auto-detect from file)
@@ -26,14 +22,18 @@ AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32
   }
   // else, it will use the native sample rate of the file.
 
-  ma_decoder decoder;
-  ma_result result = ma_decoder_init_memory(file_buffer.data(), file_buffer.size(), &decoder_config, &decoder);
-
-  if (result != MA_SUCCESS) {
-    std::cerr << "Failed to initialize audio decoder: " << ma_result_description(result) << std::endl;
-    return audio_data;  // Return empty data
+  // Likewise, miniaudio mixes the source channels down or up to a target channel count
+  if (target_channels.has_value() && *target_channels > 0) {
+    decoder_config.channels = *target_channels;
   }
 
+  return decoder_config;
+}
+
+// Reads all PCM frames from an initialized decoder and uninitializes it.
+static AudioData DecodeFrames(ma_decoder &decoder) {
+  AudioData audio_data;
+
   // Store the actual output sample rate and channels
   // If resampling was requested, decoder.outputSampleRate will be target_sample_rate.
   // Otherwise, it will be the native sample rate of the file.
@@ -41,41 +41,39 @@ AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32
   audio_data.channels = decoder.outputChannels;
 
   if (audio_data.channels == 0 || audio_data.sample_rate == 0) {
-    std::cerr << "Failed to determine audio channels or sample rate." << std::endl;
+    LogWarning("Failed to determine audio channels or sample rate.");
     ma_decoder_uninit(&decoder);
     return {};
   }
 
-  // Estimate total frames to reserve space, can be rough
+  // Frames are decoded straight into the output vector. When the length is known it is sized once up front,
+  // otherwise it grows chunk by chunk and is trimmed at the end.
+  const ma_uint64 FRAMES_PER_READ = 4096;  // Read 4096 frames at a time
   ma_uint64 total_frames_estimate;
-  result = ma_decoder_get_length_in_pcm_frames(&decoder, &total_frames_estimate);
+  ma_result result = ma_decoder_get_length_in_pcm_frames(&decoder, &total_frames_estimate);
   if (result == MA_SUCCESS && total_frames_estimate > 0) {
-    audio_data.samples.reserve(total_frames_estimate * audio_data.channels);
+    // One extra chunk so a slightly short estimate does not cause a reallocation
+    audio_data.samples.reserve((total_frames_estimate + FRAMES_PER_READ) * audio_data.channels);
   } else {
     // Fallback if length couldn't be determined, e.g., for some streams
     // Reserve a moderate amount, vector will grow if needed.
     audio_data.samples.reserve(44100 * 2 * 5);  // 5 seconds of stereo audio at 44.1kHz
   }
 
-  // Buffer to read frames into
-  // Reading in chunks is generally more efficient than one frame at a time
-  const ma_uint64 FRAMES_PER_READ = 4096;  // Read 4096 frames at a time
-  std::vector<float> temp_buffer(FRAMES_PER_READ * audio_data.channels);
-
+  size_t frames_decoded = 0;
   ma_uint64 frames_read_this_iteration;
   while (true) {
-    result = ma_decoder_read_pcm_frames(&decoder, temp_buffer.data(), FRAMES_PER_READ, &frames_read_this_iteration);
+    audio_data.samples.resize((frames_decoded + FRAMES_PER_READ) * audio_data.channels);
+    result = ma_decoder_read_pcm_frames(&decoder, audio_data.samples.data() + frames_decoded * audio_data.channels,
+                                        FRAMES_PER_READ, &frames_read_this_iteration);
 
     if (result != MA_SUCCESS && result != MA_AT_END) {  // MA_AT_END is not an error for reading
-      std::cerr << "Failed to read PCM frames: " << ma_result_description(result) << std::endl;
+      LogWarning("Failed to read PCM frames: %s", ma_result_description(result));
       ma_decoder_uninit(&decoder);
       return {};  // Return empty data on read error
     }
 
-    if (frames_read_this_iteration > 0) {
-      audio_data.samples.insert(audio_data.samples.end(), temp_buffer.data(),
-                                temp_buffer.data() + (frames_read_this_iteration * audio_data.channels));
-    }
+    frames_decoded += frames_read_this_iteration;
 
     // MA_AT_END means the end of the stream was reached.
     // frames_read_this_iteration == 0 also indicates no more data.
@@ -83,7 +81,78 @@ AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32
       break;
     }
   }
+  audio_data.samples.resize(frames_decoded * audio_data.channels);
 
   ma_decoder_uninit(&decoder);
   return audio_data;
 }
+
+AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32_t> target_sample_rate,
+                    std::optional<int32_t> target_channels) {
+  return ReadAudio(std::string_view(reinterpret_cast<const char *>(file_buffer.data()), file_buffer.size()),
+                   target_sample_rate, target_channels);
+}
+
+AudioData ReadAudio(std::string_view file_buffer, std::optional<int32_t> target_sample_rate,
+                    std::optional<int32_t> target_channels) {
+  if (file_buffer.empty()) {
+    LogWarning("Input file buffer is empty.");
+    return {};  // Return empty data
+  }
+
+  ma_decoder_config decoder_config = MakeDecoderConfig(target_sample_rate, target_channels);
+
+  ma_decoder decoder;
+  ma_result result = ma_decoder_init_memory(file_buffer.data(), file_buffer.size(), &decoder_config, &decoder);
+
+  if (result != MA_SUCCESS) {
+    LogWarning("Failed to initialize audio decoder: %s", ma_result_description(result));
+    return {};  // Return empty data
+  }
+
+  return DecodeFrames(decoder);
+}
+
+AudioData MakeSpeechLikeSignal(int32_t sample_rate, float seconds, int32_t channels) {
+  AudioData wave;
+  wave.sample_rate = sample_rate;
+  wave.channels = channels;
+  const size_t frames = static_cast<size_t>(sample_rate * seconds);
+  wave.samples.resize(frames * channels);
+
+  uint32_t seed = 12345;
+  for (int32_t channel = 0; channel < channels; ++channel) {
+    double phase = 0;
+    for (size_t i = 0; i < frames; ++i) {
+      double t = static_cast<double>(i) / sample_rate;
+      double freq = 150 + 50 * channel + 100 * std::sin(2 * M_PI * 0.5 * t);
+      phase += 2 * M_PI * freq / sample_rate;
+      seed = seed * 1664525u + 1013904223u;
+      double noise = (static_cast<double>(seed >> 8) / (1u << 24) - 0.5) * 0.02;
+      wave.samples[i * channels + channel] =
+        static_cast<float>(0.2 * std::sin(phase) + 0.1 * std::sin(2 * phase) + noise);
+    }
+  }
+  return wave;
+}
+
+bool IsSilent(const AudioData &wave, float threshold_dbfs, float min_voiced_seconds) {
+  const size_t frame_length = std::max<size_t>(1, wave.sample_rate * 3 / 100) * wave.channels;
+  // Compare mean squares instead of taking a square root per frame
+  const double threshold = std::pow(10.0, threshold_dbfs / 10.0);
+  const size_t min_voiced_frames =
+    static_cast<size_t>(std::ceil(min_voiced_seconds * wave.sample_rate * wave.channels / frame_length));
+
+  size_t voiced_frames = 0;
+  for (size_t start = 0; start < wave.samples.size(); start += frame_length) {
+    const size_t end = std::min(start + frame_length, wave.samples.size());
+    double energy = 0;
+    for (size_t i = start; i < end; ++i) {
+      energy += static_cast<double>(wave.samples[i]) * wave.samples[i];
+    }
+    if (energy / (end - start) > threshold && ++voiced_frames >= std::max<size_t>(1, min_voiced_frames)) {
+      return false;
+    }
+  }
+  return true;
+}
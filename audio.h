@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 
@@ -13,4 +14,19 @@ struct AudioData {
   bool isValid() const { return !samples.empty() && sample_rate > 0 && channels > 0; }
 };
 
-AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32_t> target_sample_rate = std::nullopt);
+// Decodes a whole audio file. With a target sample rate or channel count, miniaudio converts while decoding;
+// otherwise the file's own format is kept.
+AudioData ReadAudio(const std::vector<uint8_t> &file_buffer, std::optional<int32_t> target_sample_rate = std::nullopt,
+                    std::optional<int32_t> target_channels = std::nullopt);
+// Decodes straight from the caller's buffer, e.g. the body of a multipart part, without copying it.
+AudioData ReadAudio(std::string_view file_buffer, std::optional<int32_t> target_sample_rate = std::nullopt,
+                    std::optional<int32_t> target_channels = std::nullopt);
+
+// Builds a speech-like test signal: a gliding tone with harmonics plus low-level noise, interleaved when there are
+// several channels. Each channel glides 50 Hz above the previous one so that channels neither cancel nor duplicate
+// each other. Used to warm up recognizers and to synthesize benchmark input.
+AudioData MakeSpeechLikeSignal(int32_t sample_rate, float seconds, int32_t channels = 1);
+
+// Cheap energy-based voice activity check run before inference. The clip is split into 30 ms frames and counts as
+// silent when less than `min_voiced_seconds` worth of frames have an RMS level above `threshold_dbfs`.
+bool IsSilent(const AudioData &wave, float threshold_dbfs, float min_voiced_seconds);
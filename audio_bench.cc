@@ -0,0 +1,384 @@
+// Microbenchmark of ReadAudio: decoding WAV and FLAC at several sample rates and channel counts, with and without
+// resampling to 16 kHz, plus decoding stereo to 16 kHz mono through ReadAudio's channel conversion. The test files
+// are synthesized in memory from the warm-up signal, so no audio files are needed. Prints a JSON report with MB/s
+// of encoded input and ns per decoded source sample for each case.
+//
+//   sense-voice-audio-bench [--runs N] [--min-time S] [--filter TEXT] [--output FILE]
+//                           [--baseline FILE] [--tolerance F]
+//
+// With --baseline, each case is compared with the same case of an earlier report (written with --output), and the
+// exit status is 1 if any case got more than `--tolerance` (default 0.1, i.e. 10%) slower per sample. Baselines are
+// only meaningful on the same machine and build type; raise the tolerance on shared or virtualized runners.
+//
+// MP3 is not covered: there is no MP3 encoder in the tree to synthesize a test file with.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "logger.h"
+
+constexpr float CLIP_SECONDS = 10;
+constexpr int32_t TARGET_SAMPLE_RATE = 16000;
+constexpr uint32_t FLAC_BLOCK_SIZE = 4096;
+
+struct BenchOptions {
+  size_t runs = 5;        // Timed runs per case, the fastest is reported
+  double min_time = 0.1;  // Seconds each run repeats the case for
+  std::string filter;     // Only cases whose name contains this
+  std::string output;
+  std::string baseline;
+  double tolerance = 0.1;
+};
+
+// A decode path under test.
+enum class DecodeMode { kNative, kResample, kDownmix };
+
+static const char *DecodeModeName(DecodeMode mode) {
+  switch (mode) {
+    case DecodeMode::kNative:
+      return "native";
+    case DecodeMode::kResample:
+      return "resample16k";
+    case DecodeMode::kDownmix:
+      return "mono16k";
+  }
+  return "unknown";
+}
+
+static void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: sense-voice-audio-bench [--runs N] [--min-time S] [--filter TEXT] [--output FILE] "
+               "[--baseline FILE] [--tolerance F]\n");
+}
+
+static bool ParseArgs(int argc, char **argv, BenchOptions &options) {
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (i + 1 >= argc) return false;
+      const std::string value = argv[++i];
+      if (arg == "--runs") {
+        options.runs = std::stoul(value);
+      } else if (arg == "--min-time") {
+        options.min_time = std::stod(value);
+      } else if (arg == "--filter") {
+        options.filter = value;
+      } else if (arg == "--output") {
+        options.output = value;
+      } else if (arg == "--baseline") {
+        options.baseline = value;
+      } else if (arg == "--tolerance") {
+        options.tolerance = std::stod(value);
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception &) {
+    return false;
+  }
+  return options.runs > 0 && options.min_time > 0 && options.tolerance >= 0;
+}
+
+// Interleaved 16-bit PCM of the speech-like signal recognizers are warmed up with.
+static std::vector<int16_t> MakeSignal(int32_t sample_rate, int32_t channels) {
+  const auto wave = MakeSpeechLikeSignal(sample_rate, CLIP_SECONDS, channels);
+  std::vector<int16_t> samples(wave.samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = static_cast<int16_t>(std::lround(wave.samples[i] * 32767));
+  }
+  return samples;
+}
+
+static void AppendLittleEndian(std::string &out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+static std::string EncodeWav(const std::vector<int16_t> &samples, int32_t sample_rate, int32_t channels) {
+  const uint32_t data_bytes = samples.size() * sizeof(int16_t);
+  std::string out = "RIFF";
+  AppendLittleEndian(out, 36 + data_bytes, 4);
+  out += "WAVEfmt ";
+  AppendLittleEndian(out, 16, 4);
+  AppendLittleEndian(out, 1, 2);  // PCM
+  AppendLittleEndian(out, channels, 2);
+  AppendLittleEndian(out, sample_rate, 4);
+  AppendLittleEndian(out, sample_rate * channels * 2, 4);
+  AppendLittleEndian(out, channels * 2, 2);
+  AppendLittleEndian(out, 16, 2);
+  out += "data";
+  AppendLittleEndian(out, data_bytes, 4);
+  out.append(reinterpret_cast<const char *>(samples.data()), data_bytes);
+  return out;
+}
+
+// MSB-first bit writer for FLAC frames.
+class BitWriter {
+ public:
+  explicit BitWriter(std::string &out) : out_(out) {}
+
+  void write(uint64_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+      current_ = static_cast<uint8_t>(current_ << 1 | ((value >> i) & 1));
+      if (++used_ == 8) flush();
+    }
+  }
+
+  // Writes `count` zero bits followed by a one, the unary part of a Rice code.
+  void writeUnary(uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) write(0, 1);
+    write(1, 1);
+  }
+
+  void alignToByte() {
+    if (used_ > 0) write(0, 8 - used_);
+  }
+
+ private:
+  void flush() {
+    out_.push_back(static_cast<char>(current_));
+    current_ = 0;
+    used_ = 0;
+  }
+
+  std::string &out_;
+  uint8_t current_ = 0;
+  int used_ = 0;
+};
+
+static uint8_t Crc8(const std::string &data, size_t begin) {
+  uint8_t crc = 0;
+  for (size_t i = begin; i < data.size(); ++i) {
+    crc ^= static_cast<uint8_t>(data[i]);
+    for (int bit = 0; bit < 8; ++bit) crc = crc & 0x80 ? static_cast<uint8_t>(crc << 1 ^ 0x07) : crc << 1;
+  }
+  return crc;
+}
+
+static uint16_t Crc16(const std::string &data, size_t begin) {
+  uint16_t crc = 0;
+  for (size_t i = begin; i < data.size(); ++i) {
+    crc ^= static_cast<uint16_t>(static_cast<uint8_t>(data[i]) << 8);
+    for (int bit = 0; bit < 8; ++bit) crc = crc & 0x8000 ? static_cast<uint16_t>(crc << 1 ^ 0x8005) : crc << 1;
+  }
+  return crc;
+}
+
+// FLAC's UTF-8-style variable-length frame number.
+static void WriteFrameNumber(BitWriter &writer, uint32_t number) {
+  if (number < 0x80) {
+    writer.write(number, 8);
+    return;
+  }
+  int continuation_bytes = 1;
+  while (number >= (1u << (5 * continuation_bytes + 6))) ++continuation_bytes;
+  const uint32_t lead_marker = (0xff00u >> (continuation_bytes + 1)) & 0xff;
+  writer.write(lead_marker | number >> (6 * continuation_bytes), 8);
+  for (int i = continuation_bytes - 1; i >= 0; --i) {
+    writer.write(0x80 | ((number >> (6 * i)) & 0x3f), 8);
+  }
+}
+
+// One FIXED order-2 subframe with a single Rice partition, the common case for smooth signals. Blocks too short
+// for the predictor are stored verbatim.
+static void WriteSubframe(BitWriter &writer, const std::vector<int32_t> &block) {
+  constexpr size_t order = 2;
+  writer.write(0, 1);  // Padding
+  writer.write(block.size() > order ? 0b001010 : 0b000001, 6);  // FIXED order 2, or VERBATIM
+  writer.write(0, 1);                                           // No wasted bits
+  if (block.size() <= order) {
+    for (int32_t sample : block) writer.write(static_cast<uint16_t>(sample), 16);
+    return;
+  }
+  for (size_t i = 0; i < order; ++i) writer.write(static_cast<uint16_t>(block[i]), 16);
+
+  std::vector<uint32_t> residuals;
+  uint64_t sum = 0;
+  for (size_t i = order; i < block.size(); ++i) {
+    const int32_t residual = block[i] - 2 * block[i - 1] + block[i - 2];
+    const uint32_t folded = residual >= 0 ? 2u * residual : 2u * -residual - 1;
+    residuals.push_back(folded);
+    sum += folded;
+  }
+  uint32_t parameter = 0;
+  while (parameter < 14 && (static_cast<uint64_t>(residuals.size()) << (parameter + 1)) < sum) ++parameter;
+
+  writer.write(0, 2);  // Rice coding with 4-bit parameters
+  writer.write(0, 4);  // Partition order 0
+  writer.write(parameter, 4);
+  for (uint32_t folded : residuals) {
+    writer.writeUnary(folded >> parameter);
+    writer.write(folded & ((1u << parameter) - 1), parameter);
+  }
+}
+
+static std::string EncodeFlac(const std::vector<int16_t> &samples, int32_t sample_rate, int32_t channels) {
+  const uint64_t frames = samples.size() / channels;
+  std::string out = "fLaC";
+  {
+    BitWriter writer(out);
+    writer.write(1, 1);  // Last metadata block
+    writer.write(0, 7);  // STREAMINFO
+    writer.write(34, 24);
+    writer.write(FLAC_BLOCK_SIZE, 16);
+    writer.write(FLAC_BLOCK_SIZE, 16);
+    writer.write(0, 24);  // Frame sizes unknown
+    writer.write(0, 24);
+    writer.write(sample_rate, 20);
+    writer.write(channels - 1, 3);
+    writer.write(15, 5);  // 16 bits per sample
+    writer.write(frames, 36);
+    writer.write(0, 64);  // MD5 not computed
+    writer.write(0, 64);
+  }
+
+  std::vector<int32_t> block;
+  for (uint64_t start = 0, number = 0; start < frames; start += FLAC_BLOCK_SIZE, ++number) {
+    const uint32_t block_size = static_cast<uint32_t>(std::min<uint64_t>(FLAC_BLOCK_SIZE, frames - start));
+    const size_t frame_begin = out.size();
+    BitWriter writer(out);
+    writer.write(0b11111111111110, 14);  // Sync code
+    writer.write(0, 1);
+    writer.write(0, 1);       // Fixed block size
+    writer.write(0b0111, 4);  // Block size - 1 follows as 16 bits
+    writer.write(0, 4);       // Sample rate from STREAMINFO
+    writer.write(channels - 1, 4);
+    writer.write(0b100, 3);  // 16 bits per sample
+    writer.write(0, 1);
+    WriteFrameNumber(writer, static_cast<uint32_t>(number));
+    writer.write(block_size - 1, 16);
+    writer.write(Crc8(out, frame_begin), 8);
+
+    for (int32_t channel = 0; channel < channels; ++channel) {
+      block.clear();
+      for (uint32_t i = 0; i < block_size; ++i) block.push_back(samples[(start + i) * channels + channel]);
+      WriteSubframe(writer, block);
+    }
+    writer.alignToByte();
+    writer.write(Crc16(out, frame_begin), 16);
+  }
+  return out;
+}
+
+// Decodes `file` through ReadAudio the way the case under test asks for and returns the number of decoded samples.
+static size_t Decode(const std::string &file, DecodeMode mode) {
+  const std::optional<int32_t> sample_rate =
+    mode == DecodeMode::kNative ? std::nullopt : std::optional<int32_t>(TARGET_SAMPLE_RATE);
+  const std::optional<int32_t> channels = mode == DecodeMode::kDownmix ? std::optional<int32_t>(1) : std::nullopt;
+  return ReadAudio(std::string_view(file), sample_rate, channels).samples.size();
+}
+
+// Seconds per decode in the fastest of `runs` runs, each repeating the decode for at least `min_time` seconds.
+// The fastest run is the one least disturbed by other load, which keeps baseline comparisons stable.
+static double TimeDecode(const std::string &file, DecodeMode mode, const BenchOptions &options) {
+  Decode(file, mode);  // Warm caches and the allocator
+  double fastest = 0;
+  for (size_t run = 0; run < options.runs; ++run) {
+    size_t iterations = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+      Decode(file, mode);
+      ++iterations;
+      elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    } while (elapsed < options.min_time);
+    const double per_decode = elapsed / iterations;
+    if (run == 0 || per_decode < fastest) fastest = per_decode;
+  }
+  return fastest;
+}
+
+int32_t main(int32_t argc, char **argv) {
+  SetLogStream(stderr);
+
+  BenchOptions options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return -1;
+  }
+
+  nlohmann::json baseline;
+  if (!options.baseline.empty()) {
+    std::ifstream stream(options.baseline);
+    baseline = nlohmann::json::parse(stream, nullptr, false);
+    if (baseline.is_discarded() || !baseline.contains("cases") || !baseline["cases"].is_object()) {
+      std::fprintf(stderr, "Cannot read baseline %s\n", options.baseline.c_str());
+      return -1;
+    }
+    // Every case needs a positive time to compare against, checked before anything runs
+    for (const auto &[name, result] : baseline["cases"].items()) {
+      if (!result.is_object() || !result.contains("ns_per_sample") || !result["ns_per_sample"].is_number() ||
+          result["ns_per_sample"].get<double>() <= 0) {
+        std::fprintf(stderr, "Baseline %s: case %s has no positive ns_per_sample\n", options.baseline.c_str(),
+                     name.c_str());
+        return -1;
+      }
+    }
+  }
+
+  nlohmann::json cases = nlohmann::json::object();
+  bool regressed = false;
+  for (const char *format : {"wav", "flac"}) {
+    for (int32_t sample_rate : {8000, 16000, 44100, 48000}) {
+      for (int32_t channels : {1, 2}) {
+        const auto signal = MakeSignal(sample_rate, channels);
+        const std::string file = std::strcmp(format, "wav") == 0 ? EncodeWav(signal, sample_rate, channels)
+                                                                 : EncodeFlac(signal, sample_rate, channels);
+
+        // The synthesized file must decode back to the signal, or the timings would be of an error path
+        const auto decoded = ReadAudio(std::string_view(file));
+        if (decoded.samples.size() != signal.size() ||
+            std::lround(decoded.samples[signal.size() / 2] * 32768) != signal[signal.size() / 2]) {
+          std::fprintf(stderr, "Synthesized %s file does not decode correctly\n", format);
+          return -1;
+        }
+
+        for (DecodeMode mode : {DecodeMode::kNative, DecodeMode::kResample, DecodeMode::kDownmix}) {
+          if (mode == DecodeMode::kDownmix && channels == 1) continue;
+          const std::string name = std::string(format) + "/" + std::to_string(sample_rate) + "hz/" +
+                                   std::to_string(channels) + "ch/" + DecodeModeName(mode);
+          if (name.find(options.filter) == std::string::npos) continue;
+
+          const double seconds = TimeDecode(file, mode, options);
+          const double ns_per_sample = seconds * 1e9 / signal.size();
+          nlohmann::json result = {{"bytes", file.size()},
+                                   {"mb_per_s", file.size() / seconds / 1e6},
+                                   {"ns_per_sample", ns_per_sample}};
+
+          if (!options.baseline.empty() && baseline["cases"].contains(name)) {
+            const double previous = baseline["cases"][name]["ns_per_sample"].get<double>();
+            const double change = ns_per_sample / previous - 1;
+            result["baseline_ns_per_sample"] = previous;
+            result["change"] = change;
+            if (change > options.tolerance) {
+              std::fprintf(stderr, "%s regressed by %.1f%%\n", name.c_str(), change * 100);
+              regressed = true;
+            }
+          }
+          cases[name] = result;
+        }
+      }
+    }
+  }
+
+  nlohmann::json report = {{"clip_seconds", CLIP_SECONDS}, {"runs", options.runs}, {"cases", cases}};
+  if (!options.baseline.empty()) {
+    report["baseline"] = options.baseline;
+    report["tolerance"] = options.tolerance;
+    report["regressed"] = regressed;
+  }
+  const std::string text = report.dump(2);
+  std::printf("%s\n", text.c_str());
+  if (!options.output.empty()) {
+    std::ofstream(options.output) << text << "\n";
+  }
+  return regressed ? 1 : 0;
+}
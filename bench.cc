@@ -0,0 +1,298 @@
+// Offline end-to-end benchmark: decodes every audio file of a directory with ReadAudio and recognizes it through
+// RecognitionTaskManager and the configured model, the same path the server uses minus HTTP. Prints one JSON
+// object with RTF, throughput and latency percentiles on stdout; log lines go to stderr.
+//
+//   sense-voice-bench --dir samples/ [--workers N] [--batch-size N] [--concurrency N] [--repetitions N]
+//                     [--warmup N]
+//
+// Model settings come from .env and the environment like for the server, including RECOGNIZER_BACKEND=mock to
+// benchmark the task manager without model files. Files are run in name order and the warm-up passes are not
+// measured, so results are comparable across commits on the same machine.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio.h"
+#include "config.h"
+#include "logger.h"
+#include "mock_recognizer.h"
+#include "recognizer.h"
+#include "resource_usage.h"
+#include "task_manager.h"
+
+struct BenchOptions {
+  std::string dir;
+  size_t workers = 1;
+  size_t batch_size = 1;
+  size_t concurrency = 0;  // Clips in flight at once, 0 for workers * batch_size
+  size_t repetitions = 3;
+  size_t warmup = 1;  // Unmeasured passes over all files before the measured ones
+};
+
+struct AudioFile {
+  std::string name;
+  std::vector<uint8_t> data;
+  double duration = 0;  // Seconds, from a first decode
+};
+
+// Timings of one clip in seconds. `latency` runs from the start of decoding to the result.
+struct ClipSample {
+  double latency;
+  double decode;
+  double queue;
+  double inference;
+};
+
+static void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: sense-voice-bench --dir DIR [--workers N] [--batch-size N] [--concurrency N] "
+               "[--repetitions N] [--warmup N]\n");
+}
+
+static bool ParseArgs(int argc, char **argv, BenchOptions &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) return false;
+    const std::string value = argv[++i];
+    if (arg == "--dir") {
+      options.dir = value;
+      continue;
+    }
+
+    size_t number;
+    try {
+      number = std::stoul(value);
+    } catch (const std::exception &) {
+      return false;
+    }
+    if (arg == "--workers" && number > 0) {
+      options.workers = number;
+    } else if (arg == "--batch-size" && number > 0) {
+      options.batch_size = number;
+    } else if (arg == "--concurrency") {
+      options.concurrency = number;
+    } else if (arg == "--repetitions" && number > 0) {
+      options.repetitions = number;
+    } else if (arg == "--warmup") {
+      options.warmup = number;
+    } else {
+      return false;
+    }
+  }
+  if (options.concurrency == 0) options.concurrency = options.workers * options.batch_size;
+  return !options.dir.empty();
+}
+
+// Reads the regular files of `dir` in name order, skipping those ReadAudio cannot decode.
+static std::vector<AudioFile> LoadFiles(const std::string &dir, int32_t sample_rate) {
+  std::vector<std::filesystem::path> paths;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.is_regular_file()) paths.push_back(entry.path());
+  }
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<AudioFile> files;
+  for (const auto &path : paths) {
+    std::ifstream stream(path, std::ios::binary);
+    AudioFile file;
+    file.name = path.filename().string();
+    file.data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    const AudioData wave = ReadAudio(file.data, sample_rate);
+    if (!wave.isValid()) {
+      LogWarning("Skipping %s, not a supported audio file", file.name.c_str());
+      continue;
+    }
+    file.duration = wave.samples.size() / static_cast<double>(wave.sample_rate);
+    files.push_back(std::move(file));
+  }
+  return files;
+}
+
+// Runs every file `repetitions` times from `concurrency` client threads, each decoding a clip, submitting it and
+// waiting for its result before taking the next one.
+static std::vector<ClipSample> RunPasses(const std::vector<AudioFile> &files, size_t repetitions,
+                                         size_t concurrency, int32_t sample_rate, const RecognitionOptions &options,
+                                         RecognitionTaskManager &task_manager) {
+  const size_t total = files.size() * repetitions;
+  std::atomic<size_t> next{0};
+  std::vector<ClipSample> samples;
+  std::mutex samples_mutex;
+
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < concurrency; ++i) {
+    clients.emplace_back([&] {
+      std::vector<ClipSample> local;
+      for (size_t index = next++; index < total; index = next++) {
+        const auto begin = std::chrono::steady_clock::now();
+        AudioData wave = ReadAudio(files[index % files.size()].data, sample_rate);
+        const auto decode_end = std::chrono::steady_clock::now();
+        const auto recognition = task_manager.submitTask(std::move(wave), options).get();
+        const auto end = std::chrono::steady_clock::now();
+        local.push_back({std::chrono::duration<double>(end - begin).count(),
+                         std::chrono::duration<double>(decode_end - begin).count(),
+                         std::chrono::duration<double>(recognition.queue_wait).count(),
+                         std::chrono::duration<double>(recognition.inference).count()});
+      }
+      std::lock_guard<std::mutex> lock(samples_mutex);
+      samples.insert(samples.end(), local.begin(), local.end());
+    });
+  }
+  for (auto &client : clients) {
+    client.join();
+  }
+  return samples;
+}
+
+// Nearest-rank percentile of an ascending vector, in milliseconds.
+static double PercentileMs(const std::vector<double> &sorted, double percentile) {
+  if (sorted.empty()) return 0;
+  const size_t rank = static_cast<size_t>(std::ceil(percentile / 100 * sorted.size()));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1] * 1e3;
+}
+
+static nlohmann::json Summarize(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  double sum = 0;
+  for (double value : values) sum += value;
+  return {{"mean", values.empty() ? 0 : sum / values.size() * 1e3},
+          {"p50", PercentileMs(values, 50)},
+          {"p95", PercentileMs(values, 95)},
+          {"p99", PercentileMs(values, 99)},
+          {"max", values.empty() ? 0 : values.back() * 1e3}};
+}
+
+int32_t main(int32_t argc, char **argv) {
+  SetLogStream(stderr);
+
+  BenchOptions options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return -1;
+  }
+
+  Config config;
+  const auto sample_rate = config.get<int32_t>("AUDIO_RESAMPLE_RATE", 16000);
+  const auto backend = config.get<std::string>("RECOGNIZER_BACKEND", "onnx");
+  if (backend != "onnx" && backend != "mock") {
+    LogError("Invalid configuration: RECOGNIZER_BACKEND must be onnx or mock");
+    FlushLog();
+    return -1;
+  }
+
+  std::vector<AudioFile> files;
+  try {
+    files = LoadFiles(options.dir, sample_rate);
+  } catch (const std::filesystem::filesystem_error &e) {
+    LogError("Cannot read %s: %s", options.dir.c_str(), e.what());
+  }
+  if (files.empty()) {
+    LogError("No audio files to benchmark in %s", options.dir.c_str());
+    FlushLog();
+    return -1;
+  }
+
+  nlohmann::json backend_config = {{"backend", backend}};
+  RecognitionTaskFn recognize;
+  RecognitionOptions recognition_options;
+  if (backend == "mock") {
+    MockRecognizerConfig mock_config;
+    try {
+      mock_config = MockRecognizerConfig::FromConfig(config);
+    } catch (const std::exception &e) {
+      LogError("Invalid configuration: %s", e.what());
+      FlushLog();
+      return -1;
+    }
+    recognize = MakeMockRecognizer(mock_config);
+    recognition_options.language = config.get<std::string>("MODEL_LANGUAGE", "auto");
+    backend_config.update({{"mock_rtf", mock_config.rtf},
+                           {"mock_jitter", mock_config.jitter},
+                           {"mock_overhead_ms", mock_config.overhead_ms}});
+  } else {
+    const auto recognizer_config = GetRecognizerConfig(config);
+    auto recognizer = std::make_shared<Recognizer>(recognizer_config);
+    if (!recognizer->Init()) {
+      LogError("Failed to load model.");
+      FlushLog();
+      return -1;
+    }
+    recognizer->Warmup(options.workers);
+    recognition_options = recognizer->DefaultOptions();
+    recognize = [recognizer](const std::vector<AudioData> &waves, const RecognitionOptions &batch_options) {
+      return recognizer->RecognizeBatch(waves, batch_options);
+    };
+
+    const auto &model_config = recognizer_config.model_config;
+    backend_config.update({{"model", model_config.sense_voice.model},
+                           {"language", model_config.sense_voice.language},
+                           {"use_itn", model_config.sense_voice.use_itn},
+                           {"num_threads", model_config.num_threads},
+                           {"provider", model_config.provider}});
+  }
+
+  RecognitionTaskManager task_manager(recognize, options.workers, options.batch_size);
+
+  if (options.warmup > 0) {
+    RunPasses(files, options.warmup, options.concurrency, sample_rate, recognition_options, task_manager);
+  }
+
+  const double cpu_begin = GetCpuSeconds();
+  const auto begin = std::chrono::steady_clock::now();
+  const auto samples =
+    RunPasses(files, options.repetitions, options.concurrency, sample_rate, recognition_options, task_manager);
+  const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  const double cpu_seconds = GetCpuSeconds() - cpu_begin;
+
+  double audio_seconds = 0;
+  for (const auto &file : files) {
+    audio_seconds += file.duration * options.repetitions;
+  }
+
+  std::vector<double> latency, decode, queue, inference;
+  for (const auto &sample : samples) {
+    latency.push_back(sample.latency);
+    decode.push_back(sample.decode);
+    queue.push_back(sample.queue);
+    inference.push_back(sample.inference);
+  }
+
+  backend_config.update({{"dir", options.dir},
+                         {"files", files.size()},
+                         {"workers", options.workers},
+                         {"batch_size", options.batch_size},
+                         {"concurrency", options.concurrency},
+                         {"repetitions", options.repetitions},
+                         {"warmup", options.warmup},
+                         {"hardware_threads", std::thread::hardware_concurrency()}});
+  nlohmann::json report = {
+    {"config", backend_config},
+    {"clips", samples.size()},
+    {"audio_seconds", audio_seconds},
+    {"wall_seconds", wall_seconds},
+    {"cpu_seconds", cpu_seconds},
+    // Processing time per second of audio over the whole run, below 1 is faster than real time
+    {"rtf", wall_seconds / audio_seconds},
+    {"audio_seconds_per_second", audio_seconds / wall_seconds},
+    {"audio_hours_per_cpu_hour", cpu_seconds > 0 ? audio_seconds / cpu_seconds : 0},
+    {"latency_ms", Summarize(latency)},
+    {"decode_ms", Summarize(decode)},
+    {"queue_ms", Summarize(queue)},
+    {"inference_ms", Summarize(inference)},
+  };
+
+  FlushLog();
+  std::printf("%s\n", report.dump(2).c_str());
+  return 0;
+}
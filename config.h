@@ -7,15 +7,19 @@
 #include <algorithm>
 #include <cctype>
 #include <cstdint>
+#include <fstream>
 #include <unordered_map>
 #include <mutex>
 #include <optional>
 
-#include "include/dotenv.h"
+#include "logger.h"
 
+// Settings from `.env` and the process environment. Values in `.env` take precedence. The file is read into this
+// object instead of being copied into the environment, so a reload cannot race with getenv() on other threads and
+// keys removed from the file fall back to the environment the process was started with.
 class Config {
  public:
-  Config() { dotenv::init(".env"); }
+  Config() : file_values_(ReadEnvFile(".env")) {}
 
   template <typename T>
   T get(const std::string &key) const {
@@ -34,11 +38,16 @@ class Config {
     return defaultValue;
   }
 
-  bool has(const std::string &key) const {
+  // Re-reads .env and drops cached values, so later lookups see the new values.
+  void reload() {
+    auto file_values = ReadEnvFile(".env");
     std::lock_guard<std::mutex> lock(mutex_);
-    return cache_.find(key) != cache_.end() || std::getenv(key.c_str()) != nullptr;
+    file_values_ = std::move(file_values);
+    cache_.clear();
   }
 
+  bool has(const std::string &key) const { return getRawValue(key).has_value(); }
+
  private:
   std::optional<std::string> getRawValue(const std::string &key) const {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -48,35 +57,106 @@ class Config {
       return it->second;
     }
 
-    const char *env = std::getenv(key.c_str());
-    if (!env) {
+    std::string value;
+    if (auto file_it = file_values_.find(key); file_it != file_values_.end()) {
+      value = file_it->second;
+    } else if (const char *env = std::getenv(key.c_str())) {
+      value = env;
+    } else {
       return std::nullopt;  // Environment variable not found
     }
 
-    std::string value = env;
     cache_[key] = value;
     return value;
   }
 
+  // Parses `NAME=value` lines like dotenv: blank lines and `#` comments are skipped, names and values are trimmed,
+  // one pair of matching quotes around a value is removed, and `$NAME` or `${NAME}` is replaced with an earlier
+  // value of the file or the environment. A missing file yields no values.
+  static std::unordered_map<std::string, std::string> ReadEnvFile(const std::string &path) {
+    std::unordered_map<std::string, std::string> values;
+    std::ifstream file(path);
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+      if (line.empty() || line[0] == '#') continue;
+      const size_t equals = line.find('=');
+      if (equals == std::string::npos) {
+        LogWarning("%s: ignoring ill-formed line %zu", path.c_str(), line_number);
+        continue;
+      }
+
+      const std::string name = Trim(line.substr(0, equals));
+      std::string value = Trim(line.substr(equals + 1));
+      if (value.size() >= 2 && value.front() == value.back() && (value.front() == '"' || value.front() == '\'')) {
+        value = value.substr(1, value.size() - 2);
+      }
+      if (auto resolved = ResolveVariables(value, values)) {
+        values[name] = std::move(*resolved);
+      } else {
+        LogWarning("%s: ignoring line %zu, it refers to an undefined variable", path.c_str(), line_number);
+      }
+    }
+    return values;
+  }
+
+  static std::optional<std::string> ResolveVariables(const std::string &value,
+                                                     const std::unordered_map<std::string, std::string> &values) {
+    auto is_name_char = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    std::string resolved;
+    for (size_t i = 0; i < value.size();) {
+      if (value[i] != '$') {
+        resolved.push_back(value[i++]);
+        continue;
+      }
+
+      const bool braced = i + 1 < value.size() && value[i + 1] == '{';
+      const size_t begin = i + (braced ? 2 : 1);
+      size_t end = begin;
+      while (end < value.size() && is_name_char(value[end])) ++end;
+      if (end == begin || (braced && (end >= value.size() || value[end] != '}'))) {
+        resolved.push_back(value[i++]);  // A lone `$` is kept as is
+        continue;
+      }
+
+      const std::string name = value.substr(begin, end - begin);
+      if (auto it = values.find(name); it != values.end()) {
+        resolved += it->second;
+      } else if (const char *env = std::getenv(name.c_str())) {
+        resolved += env;
+      } else {
+        return std::nullopt;
+      }
+      i = end + (braced ? 1 : 0);
+    }
+    return resolved;
+  }
+
+  static std::string Trim(const std::string &value) {
+    const size_t begin = value.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    return value.substr(begin, value.find_last_not_of(" \t\r\n") - begin + 1);
+  }
+
   template <typename T>
   T convert(const std::string &value) const;
 
+  std::unordered_map<std::string, std::string> file_values_;  // Parsed .env, replaced on reload
   mutable std::unordered_map<std::string, std::string> cache_;
   mutable std::mutex mutex_;
 };
 
 template <>
-std::string Config::convert<std::string>(const std::string &value) const {
+inline std::string Config::convert<std::string>(const std::string &value) const {
   return value;
 }
 
 template <>
-int32_t Config::convert<int32_t>(const std::string &value) const {
+inline int32_t Config::convert<int32_t>(const std::string &value) const {
   return static_cast<int32_t>(std::stol(value));
 }
 
 template <>
-bool Config::convert<bool>(const std::string &value) const {
+inline bool Config::convert<bool>(const std::string &value) const {
   std::string val = value;
   std::transform(val.begin(), val.end(), val.begin(), ::tolower);
 
@@ -87,16 +167,16 @@ bool Config::convert<bool>(const std::string &value) const {
 }
 
 template <>
-int64_t Config::convert<int64_t>(const std::string &value) const {
+inline int64_t Config::convert<int64_t>(const std::string &value) const {
   return std::stoll(value);
 }
 
 template <>
-float Config::convert<float>(const std::string &value) const {
+inline float Config::convert<float>(const std::string &value) const {
   return std::stof(value);
 }
 
 template <>
-double Config::convert<double>(const std::string &value) const {
+inline double Config::convert<double>(const std::string &value) const {
   return std::stod(value);
 }
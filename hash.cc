@@ -0,0 +1,88 @@
+#include <cstring>
+
+#include "hash.h"
+
+static constexpr uint64_t PRIME64_1 = 11400714785074694791ULL;
+static constexpr uint64_t PRIME64_2 = 14029467366897019727ULL;
+static constexpr uint64_t PRIME64_3 = 1609587929392839161ULL;
+static constexpr uint64_t PRIME64_4 = 9650029242287828579ULL;
+static constexpr uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+static inline uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t Read64(const uint8_t *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t Read32(const uint8_t *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+  acc += input * PRIME64_2;
+  acc = Rotl(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t val) {
+  acc ^= Round(0, val);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const uint8_t *end = p + size;
+  uint64_t h;
+
+  if (size >= 32) {
+    // Four independent lanes over 32-byte stripes
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+    const uint8_t *limit = end - 32;
+    do {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    h = MergeRound(h, v1);
+    h = MergeRound(h, v2);
+    h = MergeRound(h, v3);
+    h = MergeRound(h, v4);
+  } else {
+    h = seed + PRIME64_5;
+  }
+
+  h += static_cast<uint64_t>(size);
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(Read32(p)) * PRIME64_1;
+    h = Rotl(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= (*p) * PRIME64_5;
+    h = Rotl(h, 11) * PRIME64_1;
+  }
+
+  // Final avalanche
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Fast non-cryptographic 64-bit hash (XXH64) used to key uploaded audio and model files.
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+inline uint64_t HashBytes(std::string_view data, uint64_t seed = 0) {
+  return HashBytes(data.data(), data.size(), seed);
+}
@@ -0,0 +1,478 @@
+// HTTP load generator for /asr: posts the audio files of a directory as multipart uploads over keep-alive
+// connections and prints one JSON report with latency percentiles and the share of 503 and 504 responses.
+//
+//   sense-voice-loadgen --dir samples/ [--url http://127.0.0.1:5000/asr] [--mode open|closed] [--rate R]
+//                       [--concurrency N] [--duration S] [--timeout S] [--token T] [--unique]
+//
+// Closed loop: `--concurrency` connections each send their next request as soon as the previous one completes.
+// Open loop: requests are scheduled at `--rate` per second regardless of how fast the server answers, spread over
+// up to `--concurrency` connections. Latency is measured from the scheduled start, so requests delayed because
+// every connection was busy count their wait (coordinated-omission correction); `service_time_ms` is measured
+// from the actual send.
+//
+// Identical uploads are answered from the server's result cache or share an in-flight task. `--unique` adds a
+// per-request chunk to every WAV file so that each request is recognized on its own; otherwise set
+// RESULT_CACHE_MAX_BYTES=0 on the server and use distinct files.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr char MULTIPART_BOUNDARY[] = "sense-voice-loadgen-boundary";
+// Size of the RIFF chunk added by --unique: "lgen", a 4-byte length and an 8-byte request counter.
+constexpr size_t UNIQUE_CHUNK_BYTES = 16;
+
+struct LoadOptions {
+  std::string dir;
+  std::string url = "http://127.0.0.1:5000/asr";
+  bool open_loop = false;
+  double rate = 10;  // Requests per second in open-loop mode
+  size_t concurrency = 8;
+  double duration = 10;  // Seconds
+  double timeout = 60;   // Seconds to wait for a response before counting an error
+  std::string token;
+  bool unique = false;
+};
+
+struct Target {
+  std::string host;
+  std::string port;
+  std::string path;
+};
+
+// A prebuilt request, sent as head + optional unique chunk + tail with writev() so it is never copied.
+struct RequestTemplate {
+  std::string head;  // Request line, headers, multipart preamble and the file
+  std::string tail;  // Multipart epilogue
+};
+
+struct RequestSample {
+  int status;                    // HTTP status, 0 on a connection error or timeout
+  Clock::duration latency;       // From the scheduled start
+  Clock::duration service_time;  // From the actual send
+};
+
+static void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: sense-voice-loadgen --dir DIR [--url URL] [--mode open|closed] [--rate R] [--concurrency N] "
+               "[--duration S] [--timeout S] [--token T] [--unique]\n");
+}
+
+static bool ParseArgs(int argc, char **argv, LoadOptions &options) {
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--unique") {
+        options.unique = true;
+        continue;
+      }
+      if (i + 1 >= argc) return false;
+      const std::string value = argv[++i];
+      if (arg == "--dir") {
+        options.dir = value;
+      } else if (arg == "--url") {
+        options.url = value;
+      } else if (arg == "--mode" && (value == "open" || value == "closed")) {
+        options.open_loop = value == "open";
+      } else if (arg == "--rate") {
+        options.rate = std::stod(value);
+      } else if (arg == "--concurrency") {
+        options.concurrency = std::stoul(value);
+      } else if (arg == "--duration") {
+        options.duration = std::stod(value);
+      } else if (arg == "--timeout") {
+        options.timeout = std::stod(value);
+      } else if (arg == "--token") {
+        options.token = value;
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception &) {
+    return false;
+  }
+  return !options.dir.empty() && options.rate > 0 && options.concurrency > 0 && options.duration > 0 &&
+         options.timeout > 0;
+}
+
+// Splits `http://host[:port]/path`. HTTPS is not supported, the load generator targets a local instance.
+static std::optional<Target> ParseUrl(const std::string &url) {
+  const std::string scheme = "http://";
+  if (url.compare(0, scheme.size(), scheme) != 0) return std::nullopt;
+  const size_t host_begin = scheme.size();
+  const size_t path_begin = url.find('/', host_begin);
+  const std::string authority = url.substr(host_begin, path_begin - host_begin);
+  if (authority.empty()) return std::nullopt;
+
+  Target target;
+  const size_t colon = authority.rfind(':');
+  target.host = colon == std::string::npos ? authority : authority.substr(0, colon);
+  target.port = colon == std::string::npos ? "80" : authority.substr(colon + 1);
+  target.path = path_begin == std::string::npos ? "/" : url.substr(path_begin);
+  return target;
+}
+
+static bool IsWav(const std::string &data) {
+  return data.size() >= 12 && data.compare(0, 4, "RIFF") == 0 && data.compare(8, 4, "WAVE") == 0;
+}
+
+// Builds the upload of `file`. With `unique`, the RIFF size is grown by the chunk appended at send time.
+static RequestTemplate BuildRequest(const Target &target, const LoadOptions &options, const std::string &name,
+                                    std::string file) {
+  if (options.unique) {
+    uint32_t riff_size;
+    std::memcpy(&riff_size, file.data() + 4, sizeof(riff_size));
+    riff_size += UNIQUE_CHUNK_BYTES;
+    std::memcpy(&file[4], &riff_size, sizeof(riff_size));
+  }
+
+  const std::string preamble = std::string("--") + MULTIPART_BOUNDARY +
+                               "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"" + name +
+                               "\"\r\nContent-Type: application/octet-stream\r\n\r\n";
+  RequestTemplate request;
+  request.tail = std::string("\r\n--") + MULTIPART_BOUNDARY + "--\r\n";
+  const size_t content_length =
+    preamble.size() + file.size() + (options.unique ? UNIQUE_CHUNK_BYTES : 0) + request.tail.size();
+
+  request.head = "POST " + target.path + " HTTP/1.1\r\nHost: " + target.host + ":" + target.port +
+                 "\r\nContent-Type: multipart/form-data; boundary=" + MULTIPART_BOUNDARY +
+                 "\r\nContent-Length: " + std::to_string(content_length) + "\r\n";
+  if (!options.token.empty()) {
+    request.head += "Authorization: Bearer " + options.token + "\r\n";
+  }
+  request.head += "\r\n" + preamble + file;
+  return request;
+}
+
+// Loads the regular files of `dir` in name order.
+static std::vector<RequestTemplate> LoadRequests(const Target &target, const LoadOptions &options) {
+  std::vector<std::filesystem::path> paths;
+  for (const auto &entry : std::filesystem::directory_iterator(options.dir)) {
+    if (entry.is_regular_file()) paths.push_back(entry.path());
+  }
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<RequestTemplate> requests;
+  for (const auto &path : paths) {
+    std::ifstream stream(path, std::ios::binary);
+    std::string file(std::istreambuf_iterator<char>(stream), {});
+    if (options.unique && !IsWav(file)) {
+      std::fprintf(stderr, "Skipping %s, --unique needs WAV files\n", path.c_str());
+      continue;
+    }
+    requests.push_back(BuildRequest(target, options, path.filename().string(), std::move(file)));
+  }
+  return requests;
+}
+
+// One keep-alive HTTP/1.1 connection, reopened after errors or `Connection: close`.
+class Connection {
+ public:
+  Connection(const Target &target, double timeout) : target_(target), timeout_(timeout) {}
+  ~Connection() { close(); }
+
+  // Sends `request` and returns the response status, or 0 if the connection failed or timed out.
+  int send(const RequestTemplate &request, std::optional<uint64_t> unique) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      // A kept-alive connection may have been closed or reset by the server in the meantime, so retry once on a
+      // new one
+      const bool reused = fd_ >= 0;
+      if (!reused && !open()) return 0;
+      if (!writeRequest(request, unique)) {
+        close();
+        if (reused && peer_closed_) continue;
+        return 0;
+      }
+      const int status = readResponse();
+      if (status == 0 && reused && received_ == 0 && peer_closed_) continue;
+      return status;
+    }
+    return 0;
+  }
+
+ private:
+  bool open() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(target_.host.c_str(), target_.port.c_str(), &hints, &addresses) != 0) return false;
+
+    for (addrinfo *address = addresses; address != nullptr; address = address->ai_next) {
+      fd_ = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+      if (fd_ < 0) continue;
+      if (connect(fd_, address->ai_addr, address->ai_addrlen) == 0) break;
+      ::close(fd_);
+      fd_ = -1;
+    }
+    freeaddrinfo(addresses);
+    if (fd_ < 0) return false;
+
+    const int no_delay = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    timeval timeout{};
+    timeout.tv_sec = static_cast<time_t>(timeout_);
+    timeout.tv_usec = static_cast<suseconds_t>((timeout_ - timeout.tv_sec) * 1e6);
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+  }
+
+  void close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    buffer_.clear();
+  }
+
+  // Whether a failed socket call means the server closed or reset the connection.
+  static bool IsPeerClosed(int error) { return error == ECONNRESET || error == EPIPE; }
+
+  bool writeRequest(const RequestTemplate &request, std::optional<uint64_t> unique) {
+    peer_closed_ = false;
+    char chunk[UNIQUE_CHUNK_BYTES];
+    std::vector<iovec> parts = {{const_cast<char *>(request.head.data()), request.head.size()}};
+    if (unique.has_value()) {
+      const uint32_t chunk_size = sizeof(*unique);
+      std::memcpy(chunk, "lgen", 4);
+      std::memcpy(chunk + 4, &chunk_size, sizeof(chunk_size));
+      std::memcpy(chunk + 8, &*unique, sizeof(*unique));
+      parts.push_back({chunk, sizeof(chunk)});
+    }
+    parts.push_back({const_cast<char *>(request.tail.data()), request.tail.size()});
+
+    size_t index = 0;
+    while (index < parts.size()) {
+      const ssize_t written = writev(fd_, &parts[index], static_cast<int>(parts.size() - index));
+      if (written < 0) {
+        peer_closed_ = IsPeerClosed(errno);
+        return false;
+      }
+      // Skip the fully written parts and advance into a partially written one
+      size_t remaining = written;
+      while (index < parts.size() && remaining >= parts[index].iov_len) {
+        remaining -= parts[index].iov_len;
+        ++index;
+      }
+      if (index < parts.size()) {
+        parts[index].iov_base = static_cast<char *>(parts[index].iov_base) + remaining;
+        parts[index].iov_len -= remaining;
+      }
+    }
+    return true;
+  }
+
+  // Reads one response with a Content-Length body, returns its status or 0.
+  int readResponse() {
+    received_ = 0;
+    peer_closed_ = false;
+    size_t header_end;
+    while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (!receive()) return 0;
+    }
+
+    int status = 0;
+    if (std::sscanf(buffer_.c_str(), "HTTP/1.%*d %d", &status) != 1) {
+      close();
+      return 0;
+    }
+
+    const std::string headers = ToLower(buffer_.substr(0, header_end));
+    size_t content_length = 0;
+    const size_t length_pos = headers.find("\r\ncontent-length:");
+    if (length_pos != std::string::npos) {
+      content_length = std::strtoull(headers.c_str() + length_pos + 17, nullptr, 10);
+    }
+    const size_t response_size = header_end + 4 + content_length;
+    while (buffer_.size() < response_size) {
+      if (!receive()) return 0;
+    }
+
+    buffer_.erase(0, response_size);
+    if (headers.find("\r\nconnection: close") != std::string::npos) close();
+    return status;
+  }
+
+  bool receive() {
+    char chunk[16384];
+    const ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n <= 0) {
+      peer_closed_ = n == 0 || IsPeerClosed(errno);
+      close();
+      return false;
+    }
+    received_ += n;
+    buffer_.append(chunk, n);
+    return true;
+  }
+
+  static std::string ToLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+    return value;
+  }
+
+  const Target &target_;
+  double timeout_;
+  int fd_ = -1;
+  std::string buffer_;   // Received bytes not yet consumed
+  size_t received_ = 0;        // Bytes received for the current response
+  bool peer_closed_ = false;  // The last failure was the server closing or resetting the connection
+};
+
+// Nearest-rank percentile of an ascending vector, in milliseconds.
+static double PercentileMs(const std::vector<double> &sorted, double percentile) {
+  if (sorted.empty()) return 0;
+  const size_t rank = static_cast<size_t>(std::ceil(percentile / 100 * sorted.size()));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1] * 1e3;
+}
+
+static nlohmann::json Summarize(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  double sum = 0;
+  for (double value : values) sum += value;
+  return {{"mean", values.empty() ? 0 : sum / values.size() * 1e3},
+          {"p50", PercentileMs(values, 50)},
+          {"p90", PercentileMs(values, 90)},
+          {"p99", PercentileMs(values, 99)},
+          {"p99.9", PercentileMs(values, 99.9)},
+          {"max", values.empty() ? 0 : values.back() * 1e3}};
+}
+
+int32_t main(int32_t argc, char **argv) {
+  // Writing to a connection the server has closed must fail with EPIPE instead of killing the process
+  signal(SIGPIPE, SIG_IGN);
+
+  LoadOptions options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return -1;
+  }
+  const auto target = ParseUrl(options.url);
+  if (!target.has_value()) {
+    std::fprintf(stderr, "Invalid URL %s, expected http://host[:port]/path\n", options.url.c_str());
+    return -1;
+  }
+
+  std::vector<RequestTemplate> requests;
+  try {
+    requests = LoadRequests(*target, options);
+  } catch (const std::filesystem::filesystem_error &e) {
+    std::fprintf(stderr, "Cannot read %s: %s\n", options.dir.c_str(), e.what());
+  }
+  if (requests.empty()) {
+    std::fprintf(stderr, "No files to upload in %s\n", options.dir.c_str());
+    return -1;
+  }
+
+  const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / options.rate));
+  const auto begin = Clock::now();
+  const auto deadline = begin + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(options.duration));
+  std::atomic<uint64_t> next{0};
+  std::atomic<uint64_t> not_sent{0};
+  std::vector<RequestSample> samples;
+  std::mutex samples_mutex;
+
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < options.concurrency; ++i) {
+    clients.emplace_back([&] {
+      Connection connection(*target, options.timeout);
+      std::vector<RequestSample> local;
+      while (true) {
+        const uint64_t index = next++;
+        auto scheduled = Clock::now();
+        if (options.open_loop) {
+          scheduled = begin + interval * index;
+          if (scheduled >= deadline) break;
+          // The schedule cannot be kept at all any more, counting these keeps the report from hiding it
+          if (Clock::now() >= deadline) {
+            not_sent++;
+            continue;
+          }
+          std::this_thread::sleep_until(scheduled);
+        } else if (scheduled >= deadline) {
+          break;
+        }
+
+        const auto sent = Clock::now();
+        const auto unique = options.unique ? std::optional<uint64_t>(index) : std::nullopt;
+        const int status = connection.send(requests[index % requests.size()], unique);
+        const auto end = Clock::now();
+        local.push_back({status, end - scheduled, end - sent});
+      }
+      std::lock_guard<std::mutex> lock(samples_mutex);
+      samples.insert(samples.end(), local.begin(), local.end());
+    });
+  }
+  for (auto &client : clients) {
+    client.join();
+  }
+  const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+  std::map<std::string, uint64_t> status_counts;
+  uint64_t errors = 0;
+  std::vector<double> latency, service_time;
+  for (const auto &sample : samples) {
+    if (sample.status == 0) {
+      ++errors;
+      continue;
+    }
+    ++status_counts[std::to_string(sample.status)];
+    // Only successful responses, fast 503s would otherwise make an overloaded server look quick
+    if (sample.status == 200) {
+      latency.push_back(std::chrono::duration<double>(sample.latency).count());
+      service_time.push_back(std::chrono::duration<double>(sample.service_time).count());
+    }
+  }
+  const auto share = [&](const char *code) {
+    const auto it = status_counts.find(code);
+    return it == status_counts.end() ? 0.0 : static_cast<double>(it->second) / samples.size();
+  };
+
+  nlohmann::json report = {
+    {"config",
+     {{"url", options.url},
+      {"mode", options.open_loop ? "open" : "closed"},
+      {"rate", options.open_loop ? nlohmann::json(options.rate) : nlohmann::json(nullptr)},
+      {"concurrency", options.concurrency},
+      {"duration", options.duration},
+      {"files", requests.size()},
+      {"unique", options.unique}}},
+    {"requests", samples.size()},
+    {"not_sent", not_sent.load()},
+    {"errors", errors},
+    {"elapsed_seconds", elapsed},
+    {"requests_per_second", samples.size() / elapsed},
+    {"status", status_counts},
+    {"rate_503", share("503")},
+    {"rate_504", share("504")},
+    {"latency_ms", Summarize(latency)},
+    {"service_time_ms", Summarize(service_time)},
+  };
+  std::printf("%s\n", report.dump(2).c_str());
+  return 0;
+}
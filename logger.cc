@@ -0,0 +1,273 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Ring buffer size, a power of two. At 256 bytes per slot this is 2 MiB.
+constexpr size_t LOG_BUFFER_SLOTS = 8192;
+constexpr size_t LOG_MESSAGE_BYTES = 232;
+
+static std::atomic<int> log_level{static_cast<int>(LogLevel::kInfo)};
+static std::atomic<FILE *> log_stream{nullptr};  // stdout unless set
+static std::atomic<uint64_t> next_request_id{1};
+static thread_local uint64_t current_request_id = 0;
+
+static const char *LogLevelName(LogLevel level) {
+  switch (level) {
+    case LogLevel::kDebug:
+      return "debug";
+    case LogLevel::kInfo:
+      return "info";
+    case LogLevel::kWarning:
+      return "warning";
+    case LogLevel::kError:
+      return "error";
+  }
+  return "unknown";
+}
+
+// Appends `value` as a JSON string literal.
+static void AppendEscaped(std::string &out, const char *value, size_t length) {
+  static const char HEX[] = "0123456789abcdef";
+  out.push_back('"');
+  for (size_t i = 0; i < length; ++i) {
+    const char c = value[i];
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out += "\\u00";
+      out.push_back(HEX[(c >> 4) & 0xf]);
+      out.push_back(HEX[c & 0xf]);
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+// Returns the length of `text` without a UTF-8 sequence cut off at its end, so truncated messages stay valid JSON.
+static size_t TrimPartialCharacter(const char *text, size_t length) {
+  size_t start = length;
+  while (start > 0 && (static_cast<unsigned char>(text[start - 1]) & 0xc0) == 0x80) --start;
+  if (start == 0 || (static_cast<unsigned char>(text[start - 1]) & 0x80) == 0) return length;
+
+  const auto lead = static_cast<unsigned char>(text[start - 1]);
+  const size_t expected = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : 2;
+  return length - (start - 1) < expected ? start - 1 : length;
+}
+
+// Bounded multi-producer queue of formatted messages (Vyukov's array queue) drained by one writer thread.
+// Producers claim a slot with a compare-and-swap on the enqueue position and publish it through the slot's
+// sequence number, so logging never takes a lock or allocates.
+class AsyncLogger {
+ public:
+  AsyncLogger() : slots_(new Slot[LOG_BUFFER_SLOTS]) {
+    for (size_t i = 0; i < LOG_BUFFER_SLOTS; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer_ = std::thread(&AsyncLogger::run, this);
+  }
+
+  ~AsyncLogger() {
+    running_ = false;
+    writer_.join();
+  }
+
+  void push(LogLevel level, const char *format, va_list args) {
+    size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots_[position & (LOG_BUFFER_SLOTS - 1)];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+      if (diff == 0) {
+        if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);  // Full, the writer is behind
+        return;
+      } else {
+        position = enqueuePosition_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+    slot->request_id = current_request_id;
+    slot->thread = CurrentThreadIndex();
+    slot->level = level;
+    const int length = std::vsnprintf(slot->message, LOG_MESSAGE_BYTES, format, args);
+    size_t kept = std::clamp(length, 0, static_cast<int>(LOG_MESSAGE_BYTES) - 1);
+    if (length >= static_cast<int>(LOG_MESSAGE_BYTES)) {
+      kept = TrimPartialCharacter(slot->message, kept);
+    }
+    slot->length = static_cast<uint16_t>(kept);
+    slot->sequence.store(position + 1, std::memory_order_release);
+  }
+
+  // Writes out all published lines. Called by the writer thread and by FlushLog().
+  void drain() {
+    std::lock_guard<std::mutex> lock(consumerMutex_);
+    std::string out;
+    while (true) {
+      Slot &slot = slots_[dequeuePosition_ & (LOG_BUFFER_SLOTS - 1)];
+      if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition_ + 1) break;
+      appendLine(out, slot.timestamp_us, slot.level, slot.thread, slot.request_id, slot.message, slot.length);
+      slot.sequence.store(dequeuePosition_ + LOG_BUFFER_SLOTS, std::memory_order_release);
+      ++dequeuePosition_;
+    }
+
+    if (const uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed)) {
+      char message[64];
+      const int length = std::snprintf(message, sizeof(message), "Log buffer full, dropped %llu line(s)",
+                                       static_cast<unsigned long long>(dropped));
+      const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+      appendLine(out, now, LogLevel::kWarning, 0, 0, message, length);
+    }
+
+    if (!out.empty()) {
+      FILE *stream = log_stream.load(std::memory_order_relaxed);
+      if (stream == nullptr) stream = stdout;
+      std::fwrite(out.data(), 1, out.size(), stream);
+      std::fflush(stream);
+    }
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    int64_t timestamp_us;
+    uint64_t request_id;
+    uint32_t thread;
+    LogLevel level;
+    uint16_t length;
+    char message[LOG_MESSAGE_BYTES];
+  };
+
+  static void appendLine(std::string &out, int64_t timestamp_us, LogLevel level, uint32_t thread,
+                         uint64_t request_id, const char *message, size_t length) {
+    const time_t seconds = timestamp_us / 1000000;
+    tm utc;
+    gmtime_r(&seconds, &utc);
+    char prefix[160];
+    const size_t prefix_length = std::strftime(prefix, sizeof(prefix), "{\"ts\":\"%Y-%m-%dT%H:%M:%S", &utc);
+    out.append(prefix, prefix_length);
+
+    int n = std::snprintf(prefix, sizeof(prefix), ".%03dZ\",\"level\":\"%s\",\"thread\":%u",
+                          static_cast<int>(timestamp_us / 1000 % 1000), LogLevelName(level), thread);
+    out.append(prefix, n);
+    if (request_id != 0) {
+      n = std::snprintf(prefix, sizeof(prefix), ",\"request_id\":%llu", static_cast<unsigned long long>(request_id));
+      out.append(prefix, n);
+    }
+    out += ",\"msg\":";
+    AppendEscaped(out, message, length);
+    out += "}\n";
+  }
+
+  void run() {
+    while (running_) {
+      drain();
+      // Producers never signal, polling keeps the logging call free of syscalls
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    drain();
+  }
+
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<size_t> enqueuePosition_{0};
+  alignas(64) size_t dequeuePosition_ = 0;
+  std::atomic<uint64_t> dropped_{0};
+  std::mutex consumerMutex_;  // Serializes the writer thread with FlushLog()
+  std::atomic<bool> running_{true};
+  std::thread writer_;
+};
+
+static AsyncLogger &Logger() {
+  static AsyncLogger logger;
+  return logger;
+}
+
+std::optional<LogLevel> ParseLogLevel(const std::string &name) {
+  if (name == "debug") return LogLevel::kDebug;
+  if (name == "info") return LogLevel::kInfo;
+  if (name == "warning") return LogLevel::kWarning;
+  if (name == "error") return LogLevel::kError;
+  return std::nullopt;
+}
+
+void SetLogLevel(LogLevel level) { log_level.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+void SetLogStream(FILE *stream) { log_stream.store(stream, std::memory_order_relaxed); }
+
+bool IsLogEnabled(LogLevel level) { return static_cast<int>(level) >= log_level.load(std::memory_order_relaxed); }
+
+static void LogV(LogLevel level, const char *format, va_list args) {
+  if (!IsLogEnabled(level)) return;
+  Logger().push(level, format, args);
+}
+
+void Log(LogLevel level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  LogV(level, format, args);
+  va_end(args);
+}
+
+void LogDebug(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  LogV(LogLevel::kDebug, format, args);
+  va_end(args);
+}
+
+void LogInfo(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  LogV(LogLevel::kInfo, format, args);
+  va_end(args);
+}
+
+void LogWarning(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  LogV(LogLevel::kWarning, format, args);
+  va_end(args);
+}
+
+void LogError(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  LogV(LogLevel::kError, format, args);
+  va_end(args);
+}
+
+void FlushLog() { Logger().drain(); }
+
+uint64_t NextRequestId() { return next_request_id.fetch_add(1, std::memory_order_relaxed); }
+
+uint64_t CurrentRequestId() { return current_request_id; }
+
+uint32_t CurrentThreadIndex() {
+  static std::atomic<uint32_t> next_thread{1};
+  thread_local const uint32_t thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+  return thread;
+}
+
+LogRequestScope::LogRequestScope(uint64_t request_id) : previous_(current_request_id) {
+  current_request_id = request_id;
+}
+
+LogRequestScope::~LogRequestScope() { current_request_id = previous_; }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+enum class LogLevel { kDebug, kInfo, kWarning, kError };
+
+std::optional<LogLevel> ParseLogLevel(const std::string &name);
+void SetLogLevel(LogLevel level);
+bool IsLogEnabled(LogLevel level);
+
+// Redirects log lines from stdout, e.g. to stderr for tools that print their results on stdout.
+void SetLogStream(FILE *stream);
+
+// Writes a printf-style message as one JSON line on stdout, e.g.
+// `{"ts":"2025-01-01T12:00:00.123Z","level":"info","thread":3,"request_id":42,"msg":"..."}`.
+// The caller only formats the message into a slot of a lock-free ring buffer, a background thread does the JSON
+// encoding and the writes. Messages are cut at about 230 bytes, and lines are dropped (and counted) rather than
+// blocking when the buffer is full.
+void Log(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void LogDebug(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void LogInfo(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void LogWarning(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void LogError(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Writes out everything logged so far, e.g. before the process exits.
+void FlushLog();
+
+// Returns a new process-unique request ID, starting at 1.
+uint64_t NextRequestId();
+
+// The request ID set by the innermost LogRequestScope of the calling thread, or 0.
+uint64_t CurrentRequestId();
+
+// Small process-unique index of the calling thread, as shown in log lines and traces.
+uint32_t CurrentThreadIndex();
+
+// Tags lines logged by the current thread with `request_id` while in scope.
+class LogRequestScope {
+ public:
+  explicit LogRequestScope(uint64_t request_id);
+  ~LogRequestScope();
+
+  LogRequestScope(const LogRequestScope &) = delete;
+  LogRequestScope &operator=(const LogRequestScope &) = delete;
+
+ private:
+  uint64_t previous_;
+};
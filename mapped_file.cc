@@ -0,0 +1,30 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+MappedFile::MappedFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr != MAP_FAILED) {
+      // The file is read front to back, let the kernel read ahead aggressively
+      madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const uint8_t *>(addr);
+      size_ = st.st_size;
+    }
+  }
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+  }
+}
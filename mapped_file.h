@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. Pages come from the page cache and are shared with every other
+// process mapping or reading the same file, instead of being copied onto the heap.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool isValid() const { return data_ != nullptr; }
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+  std::string_view view() const { return {reinterpret_cast<const char *>(data_), size_}; }
+
+ private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,162 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+// Threads get shards round-robin in the order they first update a metric.
+static size_t ShardIndex() {
+  static std::atomic<size_t> next_shard{0};
+  thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+  return shard;
+}
+
+// Up to 15 significant digits without trailing zeros, so counts print as integers and 0.1 as 0.1.
+static void AppendNumber(std::string &out, double value) {
+  char buf[32];
+  int len = std::snprintf(buf, sizeof(buf), "%.15g", value);
+  out.append(buf, len);
+}
+
+static void AppendHeader(std::string &out, const char *name, const char *help, const char *type) {
+  out += "# HELP ";
+  out += name;
+  out.push_back(' ');
+  out += help;
+  out += "\n# TYPE ";
+  out += name;
+  out.push_back(' ');
+  out += type;
+  out.push_back('\n');
+}
+
+void RenderCounter(std::string &out, const char *name, const char *help, double value) {
+  AppendHeader(out, name, help, "counter");
+  out += name;
+  out.push_back(' ');
+  AppendNumber(out, value);
+  out.push_back('\n');
+}
+
+static void RenderHistogram(std::string &out, const char *name, const char *help, const Histogram &histogram) {
+  const auto snapshot = histogram.snapshot();
+  AppendHeader(out, name, help, "histogram");
+  for (size_t i = 0; i <= snapshot.bounds.size(); ++i) {
+    out += name;
+    out += "_bucket{le=\"";
+    if (i < snapshot.bounds.size()) {
+      AppendNumber(out, snapshot.bounds[i]);
+    } else {
+      out += "+Inf";
+    }
+    out += "\"} ";
+    AppendNumber(out, snapshot.cumulative_counts[i]);
+    out.push_back('\n');
+  }
+  out += name;
+  out += "_sum ";
+  AppendNumber(out, snapshot.sum);
+  out += "\n";
+  out += name;
+  out += "_count ";
+  AppendNumber(out, snapshot.cumulative_counts.back());
+  out.push_back('\n');
+}
+
+void RenderGauge(std::string &out, const char *name, const char *help, double value) {
+  AppendHeader(out, name, help, "gauge");
+  out += name;
+  out.push_back(' ');
+  AppendNumber(out, value);
+  out.push_back('\n');
+}
+
+void Counter::add(uint64_t value) { shards_[ShardIndex()].value.fetch_add(value, std::memory_order_relaxed); }
+
+uint64_t Counter::value() const {
+  uint64_t total = 0;
+  for (const auto &shard : shards_) {
+    total += shard.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+  if (bounds_.size() >= MAX_HISTOGRAM_BUCKETS) {
+    throw std::invalid_argument("Histogram has " + std::to_string(bounds_.size()) + " bounds, at most " +
+                                std::to_string(MAX_HISTOGRAM_BUCKETS - 1) + " are supported");
+  }
+  std::sort(bounds_.begin(), bounds_.end());
+}
+
+void Histogram::observe(double value) {
+  const size_t bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+  auto &shard = shards_[ShardIndex()];
+  shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.sum_micros.fetch_add(static_cast<uint64_t>(std::llround(std::max(value, 0.0) * 1e6)),
+                             std::memory_order_relaxed);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.bounds = bounds_;
+  snapshot.cumulative_counts.assign(bounds_.size() + 1, 0);
+  uint64_t sum_micros = 0;
+  for (const auto &shard : shards_) {
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+      snapshot.cumulative_counts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+    sum_micros += shard.sum_micros.load(std::memory_order_relaxed);
+  }
+  for (size_t i = 1; i < snapshot.cumulative_counts.size(); ++i) {
+    snapshot.cumulative_counts[i] += snapshot.cumulative_counts[i - 1];
+  }
+  snapshot.sum = sum_micros / 1e6;
+  return snapshot;
+}
+
+// Latency buckets from 1 ms to 30 s.
+static std::vector<double> SecondsBuckets() {
+  return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+}
+
+Metrics::Metrics()
+    : decode_seconds(SecondsBuckets()),
+      queue_wait_seconds(SecondsBuckets()),
+      inference_seconds(SecondsBuckets()),
+      batch_size({1, 2, 4, 8, 16, 32, 64}) {}
+
+void Metrics::countResponse(int code) {
+  const auto it = std::find(STATUS_CODES.begin(), STATUS_CODES.end(), code);
+  responses_[it - STATUS_CODES.begin()].add();
+}
+
+double Metrics::estimatedSecondsSaved() const {
+  const uint64_t recognized_ms = audio_ms.value();
+  if (recognized_ms == 0) return 0;
+  return silent_audio_ms.value() * (inference_seconds.snapshot().sum / recognized_ms);
+}
+
+void Metrics::render(std::string &out) const {
+  AppendHeader(out, "asr_requests_total", "Responses of the /asr routes by status code.", "counter");
+  for (size_t i = 0; i < responses_.size(); ++i) {
+    out += "asr_requests_total{code=\"";
+    out += i < STATUS_CODES.size() ? std::to_string(STATUS_CODES[i]) : "other";
+    out += "\"} ";
+    AppendNumber(out, responses_[i].value());
+    out.push_back('\n');
+  }
+
+  RenderCounter(out, "asr_rejected_total", "Requests rejected because the queue was full.", rejected.value());
+  RenderCounter(out, "asr_timed_out_total", "Requests that timed out waiting for recognition.", timed_out.value());
+  RenderCounter(out, "asr_audio_seconds_total", "Seconds of audio recognized by the model.", audio_ms.value() / 1e3);
+  RenderCounter(out, "asr_silent_skipped_total", "Clips answered as no_audio without running the model.",
+                silent_skipped.value());
+  RenderCounter(out, "asr_silent_audio_seconds_total", "Seconds of audio in clips skipped as silent.",
+                silent_audio_ms.value() / 1e3);
+  RenderHistogram(out, "asr_decode_seconds", "Time to decode and resample uploaded audio.", decode_seconds);
+  RenderHistogram(out, "asr_queue_wait_seconds", "Time tasks waited in the queue.", queue_wait_seconds);
+  RenderHistogram(out, "asr_inference_seconds", "Model time per batch.", inference_seconds);
+  RenderHistogram(out, "asr_batch_size", "Clips decoded per batch.", batch_size);
+}
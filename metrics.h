@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Number of independent slots each metric is split into. Threads are spread over the slots, so concurrent updates
+// rarely touch the same cache line; reads add the slots up.
+constexpr size_t METRIC_SHARDS = 16;
+
+// Monotonic counter updated with relaxed atomic adds on the calling thread's shard.
+class Counter {
+ public:
+  void add(uint64_t value = 1);
+  uint64_t value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+  std::array<Shard, METRIC_SHARDS> shards_;
+};
+
+struct HistogramSnapshot {
+  std::vector<double> bounds;
+  std::vector<uint64_t> cumulative_counts;  // One per bound, plus the +Inf bucket
+  double sum = 0;
+};
+
+// Most buckets a histogram can have, including the +Inf bucket.
+constexpr size_t MAX_HISTOGRAM_BUCKETS = 16;
+
+// Prometheus-style histogram with fixed upper bounds. Each shard has its own buckets, count and sum, so observe()
+// is a few relaxed atomic adds without locks. The buckets are stored inline in the cache-line-aligned shard, so
+// the shards of different threads never share a cache line.
+class Histogram {
+ public:
+  // Throws std::invalid_argument for more than MAX_HISTOGRAM_BUCKETS - 1 bounds.
+  explicit Histogram(std::vector<double> bounds);
+
+  void observe(double value);
+  HistogramSnapshot snapshot() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, MAX_HISTOGRAM_BUCKETS> buckets{};
+    std::atomic<uint64_t> sum_micros{0};  // Sum of observed values in millionths
+  };
+  std::vector<double> bounds_;
+  std::array<Shard, METRIC_SHARDS> shards_;
+};
+
+// Server metrics exposed on /metrics in the Prometheus text format.
+class Metrics {
+ public:
+  Metrics();
+
+  // Responses of the /asr routes, by status code.
+  void countResponse(int code);
+
+  Counter rejected;                // Requests turned away with 503 because the queue was full
+  Counter timed_out;               // Requests answered with 504 after MAX_PROCESSING_TIME
+  Counter audio_ms;                // Milliseconds of audio sent to the model
+  Counter silent_skipped;          // Clips answered as no_audio by the silence check
+  Counter silent_audio_ms;         // Milliseconds of audio in those clips
+  Histogram decode_seconds;        // Audio decoding and resampling per request
+  Histogram queue_wait_seconds;    // Time tasks spent queued before a worker picked them up
+  Histogram inference_seconds;     // Model time per batch
+  Histogram batch_size;            // Clips per batch
+
+  // Inference time the skipped silent clips would have taken, at the average cost per second of recognized audio.
+  double estimatedSecondsSaved() const;
+
+  // Appends all metrics in the Prometheus text exposition format.
+  void render(std::string &out) const;
+
+ private:
+  static constexpr std::array<int, 10> STATUS_CODES = {200, 400, 401, 403, 404, 405, 409, 500, 503, 504};
+
+  std::array<Counter, STATUS_CODES.size() + 1> responses_;  // The last one counts all other codes
+};
+
+// Appends a single counter in the Prometheus text exposition format. `name` should end in `_total`.
+void RenderCounter(std::string &out, const char *name, const char *help, double value);
+
+// Appends a single gauge in the Prometheus text exposition format.
+void RenderGauge(std::string &out, const char *name, const char *help, double value);
@@ -5,6 +5,8 @@
 #include <string>
 #include <optional>
 
+#include "metrics.h"
+
 struct BearerAuthMiddleware {
   BearerAuthMiddleware() = default;
   BearerAuthMiddleware(const std::optional<std::string> &token) : bearer_token(token) {}
@@ -31,4 +33,21 @@ struct BearerAuthMiddleware {
   void after_handle(crow::request &req, crow::response &res, context &ctx) {}
 
   std::optional<std::string> bearer_token;
-};
\ No newline at end of file
+};
+// Counts responses of the /asr routes by status code.
+struct MetricsMiddleware {
+  MetricsMiddleware() = default;
+  MetricsMiddleware(Metrics *metrics) : metrics(metrics) {}
+
+  struct context {};
+
+  void before_handle(crow::request &req, crow::response &res, context &ctx) {}
+
+  void after_handle(crow::request &req, crow::response &res, context &ctx) {
+    if (metrics != nullptr && req.url.compare(0, 4, "/asr") == 0) {
+      metrics->countResponse(res.code);
+    }
+  }
+
+  Metrics *metrics = nullptr;
+};
@@ -0,0 +1,55 @@
+#include "mock_recognizer.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using sherpa_onnx::cxx::OfflineRecognizerResult;
+
+static const std::vector<std::string> MOCK_TOKENS = {"mock", " transcript"};
+
+MockRecognizerConfig MockRecognizerConfig::FromConfig(const Config &config) {
+  MockRecognizerConfig mock;
+  mock.rtf = config.get<double>("MOCK_RTF", 0.05);
+  mock.jitter = config.get<double>("MOCK_JITTER", 0.1);
+  mock.overhead_ms = config.get<double>("MOCK_OVERHEAD_MS", 5);
+  if (mock.rtf < 0) throw std::invalid_argument("Invalid MOCK_RTF: must not be negative");
+  if (mock.jitter < 0 || mock.jitter > 1) throw std::invalid_argument("Invalid MOCK_JITTER: must be between 0 and 1");
+  if (mock.overhead_ms < 0) throw std::invalid_argument("Invalid MOCK_OVERHEAD_MS: must not be negative");
+  return mock;
+}
+
+// A result shaped like SenseVoice output, with the tokens spread over the clip.
+static OfflineRecognizerResult MockResult(float duration, const RecognitionOptions &options) {
+  OfflineRecognizerResult result;
+  result.lang = "<|" + (options.language == "auto" ? std::string("en") : options.language) + "|>";
+  result.emotion = "<|NEUTRAL|>";
+  result.event = "<|Speech|>";
+  result.tokens = MOCK_TOKENS;
+  for (size_t i = 0; i < MOCK_TOKENS.size(); ++i) {
+    result.text += MOCK_TOKENS[i];
+    result.timestamps.push_back(duration * i / MOCK_TOKENS.size());
+  }
+  return result;
+}
+
+RecognitionTaskFn MakeMockRecognizer(const MockRecognizerConfig &config) {
+  return [config](const std::vector<AudioData> &waves, const RecognitionOptions &options) {
+    thread_local std::mt19937 random(std::random_device{}());
+    std::uniform_real_distribution<double> scale(1 - config.jitter, 1 + config.jitter);
+
+    double audio_seconds = 0;
+    std::vector<OfflineRecognizerResult> results;
+    results.reserve(waves.size());
+    for (const auto &wave : waves) {
+      const float duration = wave.samples.size() / static_cast<float>(wave.sample_rate);
+      audio_seconds += duration;
+      results.push_back(MockResult(duration, options));
+    }
+
+    const double seconds = (config.overhead_ms / 1000 + config.rtf * audio_seconds) * scale(random);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    return results;
+  };
+}
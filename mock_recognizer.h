@@ -0,0 +1,20 @@
+#pragma once
+
+#include "config.h"
+#include "task_manager.h"
+
+// Model-free backend selected with RECOGNIZER_BACKEND=mock, for benchmarking the scheduler, batching, admission
+// control and HTTP layer on machines without model files. Each batch sleeps for a simulated inference time and
+// returns a canned transcript per clip.
+struct MockRecognizerConfig {
+  double rtf = 0.05;        // MOCK_RTF, simulated seconds of inference per second of audio
+  double jitter = 0.1;      // MOCK_JITTER, the time is scaled by a uniform random factor in [1 - jitter, 1 + jitter]
+  double overhead_ms = 5;   // MOCK_OVERHEAD_MS, fixed cost per batch, which batching amortizes
+
+  // Reads the MOCK_* keys, throws std::invalid_argument naming the key if a value is out of range.
+  static MockRecognizerConfig FromConfig(const Config &config);
+};
+
+// Returns a task function that takes `overhead_ms + rtf * audio seconds` per batch. The time is slept rather than
+// spent on the CPU, so several workers overlap like inference does on spare cores.
+RecognitionTaskFn MakeMockRecognizer(const MockRecognizerConfig &config);
@@ -0,0 +1,120 @@
+#include <onnxruntime_cxx_api.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+
+#include "hash.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "model_cache.h"
+
+static std::string HashFile(const std::string &path) {
+  // Hashing through a mapping avoids copying the whole model onto the heap
+  MappedFile file(path);
+  if (!file.isValid()) return "";
+
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(HashBytes(file.view())));
+  return std::string(hex) + " " + std::to_string(file.size());
+}
+
+static std::string ReadFirstLine(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+// A temporary path next to `path` that no other process uses. The extension is kept, ONNX Runtime picks the
+// output format from it.
+static std::string TemporaryPath(const std::string &path, const std::string &extension) {
+  return path + ".tmp" + std::to_string(getpid()) + extension;
+}
+
+// Writes `content` to `path` through a temporary file, so that readers see either the old or the new file.
+static bool WriteFileAtomically(const std::string &path, const std::string &content) {
+  const std::string temporary_path = TemporaryPath(path, "");
+  {
+    std::ofstream file(temporary_path, std::ios::trunc);
+    file << content;
+    if (!file.flush()) {
+      std::remove(temporary_path.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+static std::optional<GraphOptimizationLevel> ParseOptimizationLevel(const std::string &level) {
+  if (level == "basic") return GraphOptimizationLevel::ORT_ENABLE_BASIC;
+  if (level == "extended") return GraphOptimizationLevel::ORT_ENABLE_EXTENDED;
+  if (level == "all") return GraphOptimizationLevel::ORT_ENABLE_ALL;
+  return std::nullopt;
+}
+
+std::string PrepareOptimizedModel(const std::string &model_path, const std::string &optimization_level) {
+  const std::string cache_path = model_path + ".opt.onnx";
+  const std::string hash_path = cache_path + ".hash";
+
+  const auto level = ParseOptimizationLevel(optimization_level);
+  if (!level.has_value()) {
+    LogWarning("Unknown graph optimization level '%s', skipping optimized model cache.", optimization_level.c_str());
+    return model_path;
+  }
+  if (*level == GraphOptimizationLevel::ORT_ENABLE_ALL) {
+    LogWarning("A model optimized at level 'all' may only run on CPUs like this one.");
+  }
+
+  std::string source_hash = HashFile(model_path);
+  if (source_hash.empty()) {
+    LogWarning("Cannot read model %s, skipping optimized model cache.", model_path.c_str());
+    return model_path;
+  }
+  source_hash += " " + optimization_level;
+
+  if (std::ifstream(cache_path).good() && ReadFirstLine(hash_path) == source_hash) {
+    LogInfo("Using optimized model %s", cache_path.c_str());
+    return cache_path;
+  }
+
+  // ONNX Runtime writes to a temporary file that is renamed into place once complete, and the hash follows last.
+  // A crash or another process preparing the same model cannot leave a partial model at `cache_path`, or a hash
+  // for a model that is not there.
+  LogInfo("Writing optimized model %s", cache_path.c_str());
+  std::remove(hash_path.c_str());
+  const std::string temporary_path = TemporaryPath(model_path, ".opt.onnx");
+  const auto begin = std::chrono::steady_clock::now();
+  try {
+    Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "model-cache");
+    Ort::SessionOptions session_options;
+    session_options.SetGraphOptimizationLevel(*level);
+    session_options.SetOptimizedModelFilePath(temporary_path.c_str());
+    Ort::Session session(env, model_path.c_str(), session_options);
+  } catch (const Ort::Exception &e) {
+    LogError("Failed to write optimized model: %s", e.what());
+    std::remove(temporary_path.c_str());
+    return model_path;
+  }
+
+  if (std::rename(temporary_path.c_str(), cache_path.c_str()) != 0) {
+    LogError("Failed to move the optimized model to %s, using the original model.", cache_path.c_str());
+    std::remove(temporary_path.c_str());
+    return model_path;
+  }
+  if (!WriteFileAtomically(hash_path, source_hash + "\n")) {
+    LogError("Failed to write %s, using the original model.", hash_path.c_str());
+    return model_path;
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  const float elapsed_seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() / 1000.;
+  LogInfo("Optimized model written in %.3fs", elapsed_seconds);
+  return cache_path;
+}
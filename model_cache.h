@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Returns the path of an ONNX Runtime-optimized copy of `model_path`, stored next to it as `<model>.opt.onnx`.
+// The copy is created on first use and rebuilt when the hash of the source model or the optimization level
+// (basic, extended or all) changes. Falls back to `model_path` when the optimized model cannot be written.
+std::string PrepareOptimizedModel(const std::string &model_path, const std::string &optimization_level = "extended");
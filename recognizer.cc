@@ -1,27 +1,163 @@
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
+#include "logger.h"
+#include "model_cache.h"
 #include "recognizer.h"
 
 using sherpa_onnx::cxx::OfflineRecognizer;
+using sherpa_onnx::cxx::OfflineRecognizerConfig;
 using sherpa_onnx::cxx::OfflineRecognizerResult;
 using sherpa_onnx::cxx::OfflineStream;
-using std::cerr;
-using std::cout;
+
+static const std::set<std::string> SUPPORTED_LANGUAGES = {"auto", "zh", "en", "ja", "ko", "yue"};
+
+// Clip lengths in seconds used for warm-up, covering short commands up to long dictation
+static const std::vector<float> WARMUP_DURATIONS = {1.0f, 5.0f, 15.0f};
+
+bool IsSupportedLanguage(const std::string &language) { return SUPPORTED_LANGUAGES.count(language) > 0; }
+
+OfflineRecognizerConfig GetRecognizerConfig(const Config &config, ModelVariant variant) {
+  const bool fast = variant == ModelVariant::kFast;
+  OfflineRecognizerConfig recognizer_config;
+  recognizer_config.model_config.sense_voice.model =
+    config.get<std::string>(fast ? "MODEL_WEIGHTS_FAST_LOCAL" : "MODEL_WEIGHTS_LOCAL");
+  if (config.get<bool>("MODEL_CACHE_OPTIMIZED", false)) {
+    // Extended optimizations keep the saved graph portable across CPUs, unlike layout-specific ones
+    recognizer_config.model_config.sense_voice.model =
+      PrepareOptimizedModel(recognizer_config.model_config.sense_voice.model,
+                            config.get<std::string>("ORT_GRAPH_OPTIMIZATION_LEVEL", "extended"));
+  } else if (!fast && config.get<std::string>("ORT_GRAPH_OPTIMIZATION_LEVEL", "extended") != "extended") {
+    LogWarning("ORT_GRAPH_OPTIMIZATION_LEVEL is ignored, it only applies with MODEL_CACHE_OPTIMIZED=true");
+  }
+  recognizer_config.model_config.sense_voice.use_itn = config.get<bool>("MODEL_USE_ITN");
+  recognizer_config.model_config.sense_voice.language = config.get<std::string>("MODEL_LANGUAGE");
+  recognizer_config.model_config.tokens = config.get<std::string>("MODEL_TOKENS_LOCAL");
+  if (fast) {
+    recognizer_config.model_config.tokens =
+      config.get<std::string>("MODEL_TOKENS_FAST_LOCAL", recognizer_config.model_config.tokens);
+  }
+  recognizer_config.model_config.num_threads = config.get<int32_t>("MODEL_NUM_THREADS");
+  recognizer_config.model_config.provider = config.get<std::string>("MODEL_PROVIDER", "cpu");
+  recognizer_config.model_config.debug = config.get<bool>("MODEL_DEBUG", false);
+
+  return recognizer_config;
+}
 
 bool Recognizer::Init() {
-  cout << "Loading model\n";
-  recognizer_ = std::make_unique<OfflineRecognizer>(std::move(OfflineRecognizer::Create(config_)));
-  if (!recognizer_->Get()) {
-    cerr << "Failed to create recognizer. Please check your config.\n";
-    return false;
+  std::vector<RecognitionOptions> options = {DefaultOptions()};
+  options.insert(options.end(), options_.begin(), options_.end());
+
+  for (const auto &option : options) {
+    InstanceKey key{option.language, option.use_itn};
+    if (recognizers_.count(key) > 0) continue;
+
+    OfflineRecognizerConfig config = config_;
+    config.model_config.sense_voice.language = option.language;
+    config.model_config.sense_voice.use_itn = option.use_itn;
+
+    LogInfo("Loading model (language=%s, use_itn=%d)", option.language.c_str(), option.use_itn);
+    const auto begin = std::chrono::steady_clock::now();
+    auto recognizer = std::make_unique<OfflineRecognizer>(OfflineRecognizer::Create(config));
+    if (!recognizer->Get()) {
+      LogError("Failed to create recognizer. Please check your config.");
+      return false;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const float elapsed_seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() / 1000.;
+    LogInfo("Loading model done in %.3fs", elapsed_seconds);
+
+    recognizers_.emplace(std::move(key), std::move(recognizer));
   }
-  cout << "Loading model done\n";
   return true;
 }
 
-OfflineRecognizerResult Recognizer::Recognize(const AudioData &wave) {
-  OfflineStream stream = recognizer_->CreateStream();
-  stream.AcceptWaveform(wave.sample_rate, wave.samples.data(), wave.samples.size());
-  recognizer_->Decode(&stream);
-  return recognizer_->GetResult(&stream);
+RecognitionOptions Recognizer::DefaultOptions() const {
+  RecognitionOptions options;
+  options.language = config_.model_config.sense_voice.language;
+  options.use_itn = config_.model_config.sense_voice.use_itn;
+  return options;
+}
+
+const OfflineRecognizer *Recognizer::GetInstance(const RecognitionOptions &options) const {
+  auto it = recognizers_.find(InstanceKey{options.language, options.use_itn});
+  return it != recognizers_.end() ? it->second.get() : nullptr;
+}
+
+void Recognizer::WarmupInstance(const OfflineRecognizer &recognizer, size_t concurrency) const {
+  auto run_clips = [this, &recognizer] {
+    for (float seconds : WARMUP_DURATIONS) {
+      auto wave = MakeSpeechLikeSignal(config_.feat_config.sample_rate, seconds);
+      OfflineStream stream = recognizer.CreateStream();
+      stream.AcceptWaveform(wave.sample_rate, wave.samples.data(), wave.samples.size());
+      recognizer.Decode(&stream);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < concurrency; ++i) {
+    threads.emplace_back(run_clips);
+  }
+  run_clips();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void Recognizer::Warmup(size_t concurrency) const {
+  concurrency = std::max<size_t>(concurrency, 1);
+
+  const auto begin = std::chrono::steady_clock::now();
+  for (const auto &[key, recognizer] : recognizers_) {
+    WarmupInstance(*recognizer, concurrency);
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  const float elapsed_seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() / 1000.;
+  LogInfo("Warm-up of %zu recognizer(s) done in %.3fs", recognizers_.size(), elapsed_seconds);
+}
+
+OfflineRecognizerResult Recognizer::Recognize(const AudioData &wave) { return Recognize(wave, DefaultOptions()); }
+
+OfflineRecognizerResult Recognizer::Recognize(const AudioData &wave, const RecognitionOptions &options) {
+  auto results = RecognizeBatch(&wave, 1, options);
+  return results.empty() ? OfflineRecognizerResult{} : std::move(results.front());
+}
+
+std::vector<OfflineRecognizerResult> Recognizer::RecognizeBatch(const AudioData *waves, size_t count,
+                                                                const RecognitionOptions &options) {
+  const OfflineRecognizer *recognizer = GetInstance(options);
+  if (recognizer == nullptr) {
+    throw std::invalid_argument("No model loaded for language=" + options.language +
+                                ", use_itn=" + (options.use_itn ? "true" : "false"));
+  }
+  if (count == 0) {
+    return {};
+  }
+
+  // Streams are single-use in the sherpa-onnx API, which has no way to reset one, so they cannot be pooled
+  std::vector<OfflineStream> streams;
+  streams.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    streams.push_back(recognizer->CreateStream());
+    streams.back().AcceptWaveform(waves[i].sample_rate, waves[i].samples.data(), waves[i].samples.size());
+  }
+
+  recognizer->Decode(streams.data(), static_cast<int32_t>(count));
+
+  std::vector<OfflineRecognizerResult> results;
+  results.reserve(count);
+  for (const auto &stream : streams) {
+    results.push_back(recognizer->GetResult(&stream));
+  }
+  return results;
+}
+
+std::vector<OfflineRecognizerResult> Recognizer::RecognizeBatch(const std::vector<AudioData> &waves,
+                                                                const RecognitionOptions &options) {
+  return RecognizeBatch(waves.data(), waves.size(), options);
 }
@@ -1,19 +1,78 @@
 #pragma once
 
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "audio.h"
+#include "config.h"
 #include "sherpa-onnx/c-api/cxx-api.h"
 
+// Which of the loaded models decodes a request. kFast is the optional cheaper model from MODEL_WEIGHTS_FAST_LOCAL.
+enum class ModelVariant { kDefault, kFast };
+
+// Per-request decoding settings.
+struct RecognitionOptions {
+  std::string language = "auto";
+  bool use_itn = false;
+  ModelVariant model = ModelVariant::kDefault;
+
+  bool operator==(const RecognitionOptions &other) const {
+    return language == other.language && use_itn == other.use_itn && model == other.model;
+  }
+  bool operator!=(const RecognitionOptions &other) const { return !(*this == other); }
+};
+
+bool IsSupportedLanguage(const std::string &language);
+
+// Builds the recognizer config for the main model, or for the fast model from MODEL_WEIGHTS_FAST_LOCAL and
+// MODEL_TOKENS_FAST_LOCAL, which falls back to the main tokens file.
+sherpa_onnx::cxx::OfflineRecognizerConfig GetRecognizerConfig(const Config &config,
+                                                              ModelVariant variant = ModelVariant::kDefault);
+
+// Decodes with one OfflineRecognizer per (language, use_itn) combination. sherpa-onnx fixes both at creation time
+// and gives each instance its own ONNX Runtime session, so every combination holds a full copy of the weights. The
+// set is therefore fixed and loaded up front by Init(); requests for other combinations are rejected, not loaded.
 class Recognizer {
  private:
-  std::unique_ptr<sherpa_onnx::cxx::OfflineRecognizer> recognizer_{nullptr};
+  using InstanceKey = std::pair<std::string, bool>;
+
+  // Filled by Init() before the recognizer is shared and only read afterwards, so lookups take no lock
+  std::map<InstanceKey, std::unique_ptr<sherpa_onnx::cxx::OfflineRecognizer>> recognizers_;
   sherpa_onnx::cxx::OfflineRecognizerConfig config_;
+  std::vector<RecognitionOptions> options_;
+
+  const sherpa_onnx::cxx::OfflineRecognizer *GetInstance(const RecognitionOptions &options) const;
+  void WarmupInstance(const sherpa_onnx::cxx::OfflineRecognizer &recognizer, size_t concurrency) const;
 
  public:
-  Recognizer(const sherpa_onnx::cxx::OfflineRecognizerConfig &config) : config_(config) {}
+  // `options` lists the combinations to load besides the language and ITN settings of the base config.
+  Recognizer(const sherpa_onnx::cxx::OfflineRecognizerConfig &config, std::vector<RecognitionOptions> options = {})
+      : config_(config), options_(std::move(options)) {}
   ~Recognizer() = default;
 
+  // Loads every instance. Call once, before the recognizer is used from other threads.
   bool Init();
+
+  // Runs synthetic clips of several lengths through every loaded instance, so that ONNX Runtime's lazy
+  // allocations and kernel selection happen before real requests arrive. With `concurrency` > 1 the clips are
+  // decoded from that many threads at once, so each concurrent worker gets its activation memory allocated.
+  void Warmup(size_t concurrency = 1) const;
+
+  RecognitionOptions DefaultOptions() const;
+
+  // Whether Init() loaded an instance for the language and ITN setting of `options`.
+  bool IsLoaded(const RecognitionOptions &options) const { return GetInstance(options) != nullptr; }
+
   sherpa_onnx::cxx::OfflineRecognizerResult Recognize(const AudioData &wave);
+  sherpa_onnx::cxx::OfflineRecognizerResult Recognize(const AudioData &wave, const RecognitionOptions &options);
+
+  // Decodes `count` clips in a single batched call and returns their results in the same order. Throws
+  // std::invalid_argument if no instance is loaded for `options`.
+  std::vector<sherpa_onnx::cxx::OfflineRecognizerResult> RecognizeBatch(const AudioData *waves, size_t count,
+                                                                        const RecognitionOptions &options);
+  std::vector<sherpa_onnx::cxx::OfflineRecognizerResult> RecognizeBatch(const std::vector<AudioData> &waves,
+                                                                        const RecognitionOptions &options);
 };
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Resident set size of this process in bytes, 0 if it cannot be determined.
+size_t GetResidentSetBytes();
+
+// Peak resident set size of this process in bytes, 0 if it cannot be determined.
+size_t GetPeakResidentSetBytes();
+
+// User plus system CPU time used by all threads of this process so far, in seconds.
+double GetCpuSeconds();
@@ -0,0 +1,188 @@
+#include "response.h"
+
+#include <array>
+#include <cstdio>
+#include <utility>
+
+using sherpa_onnx::cxx::OfflineRecognizerResult;
+
+// UTF-8 encoding of U+FFFD REPLACEMENT CHARACTER.
+static constexpr char REPLACEMENT_CHARACTER[] = "\xef\xbf\xbd";
+
+// Length of the multi-byte UTF-8 sequence at value[i], or 0 if it is invalid or cut off. `consumed` is set to the
+// number of bytes that belong to the (possibly invalid) sequence: the lead byte and the valid continuation bytes
+// after it. Overlong forms, surrogates and code points above U+10FFFF are invalid, as in nlohmann::json.
+static size_t Utf8SequenceLength(std::string_view value, size_t i, size_t &consumed) {
+  const auto lead = static_cast<unsigned char>(value[i]);
+  size_t length = 0;
+  unsigned char second_min = 0x80, second_max = 0xbf;
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3;
+    if (lead == 0xe0) second_min = 0xa0;
+    if (lead == 0xed) second_max = 0x9f;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4;
+    if (lead == 0xf0) second_min = 0x90;
+    if (lead == 0xf4) second_max = 0x8f;
+  }
+
+  consumed = 1;
+  if (length == 0) return 0;
+  for (; consumed < length && i + consumed < value.size(); ++consumed) {
+    const auto byte = static_cast<unsigned char>(value[i + consumed]);
+    const bool valid = consumed == 1 ? byte >= second_min && byte <= second_max : byte >= 0x80 && byte <= 0xbf;
+    if (!valid) return 0;
+  }
+  return consumed == length ? length : 0;
+}
+
+void AppendJsonString(std::string &out, std::string_view value) {
+  static const char HEX[] = "0123456789abcdef";
+  out.push_back('"');
+  for (size_t i = 0; i < value.size();) {
+    const char c = value[i];
+    if (static_cast<unsigned char>(c) >= 0x80) {
+      // Invalid bytes become one replacement character per broken sequence, like nlohmann::json's replace handler
+      size_t consumed;
+      const size_t length = Utf8SequenceLength(value, i, consumed);
+      if (length > 0) {
+        out.append(value.data() + i, length);
+      } else {
+        out += REPLACEMENT_CHARACTER;
+      }
+      i += consumed;
+      continue;
+    }
+
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out += "\\u00";
+          out.push_back(HEX[(c >> 4) & 0xf]);
+          out.push_back(HEX[c & 0xf]);
+        } else {
+          out.push_back(c);
+        }
+    }
+    ++i;
+  }
+  out.push_back('"');
+}
+
+// Appends `num` rounded to 2 decimal places, formatted like nlohmann::json prints the rounded double.
+static void AppendRounded(std::string &out, float num) {
+  double rounded = static_cast<int>(num * 100 + (num >= 0 ? 0.5 : -0.5)) / 100.0;  // Round to 2 decimal places
+  char buf[32];
+  int len = std::snprintf(buf, sizeof(buf), "%.2f", rounded);
+  // Drop trailing zeros but keep one digit after the point: 1.50 -> 1.5, 2.00 -> 2.0
+  while (len > 0 && buf[len - 1] == '0' && buf[len - 2] != '.') --len;
+  out.append(buf, len);
+}
+
+double Milliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Stage names and durations in the order a request goes through them.
+static std::array<std::pair<const char *, std::chrono::steady_clock::duration>, 6> TimingEntries(
+  const StageTimings &timings) {
+  return {{{"parse", timings.parse},
+           {"decode", timings.decode},
+           {"queue", timings.queue},
+           {"infer", timings.infer},
+           {"serialize", timings.serialize},
+           {"total", timings.total}}};
+}
+
+std::string ServerTimingHeader(const StageTimings &timings) {
+  std::string header;
+  char buf[64];
+  for (const auto &[name, duration] : TimingEntries(timings)) {
+    if (duration == std::chrono::steady_clock::duration::zero()) continue;
+    int len = std::snprintf(buf, sizeof(buf), "%s%s;dur=%.3f", header.empty() ? "" : ", ", name,
+                            Milliseconds(duration));
+    header.append(buf, len);
+  }
+  return header;
+}
+
+// Appends the `"timings":{...}` field of the /asr response, in milliseconds with sorted keys.
+static void AppendTimingsJson(std::string &out, const StageTimings &timings) {
+  char buf[192];
+  int len = std::snprintf(buf, sizeof(buf),
+                          ",\"timings\":{\"decode_ms\":%.3f,\"infer_ms\":%.3f,\"parse_ms\":%.3f,\"queue_ms\":%.3f,"
+                          "\"serialize_ms\":%.3f,\"total_ms\":%.3f}",
+                          Milliseconds(timings.decode), Milliseconds(timings.infer), Milliseconds(timings.parse),
+                          Milliseconds(timings.queue), Milliseconds(timings.serialize), Milliseconds(timings.total));
+  out.append(buf, len);
+}
+
+std::string SerializeResult(const OfflineRecognizerResult &result, bool is_no_audio, const StageTimings *timings) {
+  std::string out;
+  size_t estimate = 128 + result.lang.size() + result.emotion.size() + result.event.size() + result.text.size() +
+                    result.timestamps.size() * 8 + (timings != nullptr ? 192 : 0);
+  for (const auto &token : result.tokens) estimate += token.size() + 3;
+  out.reserve(estimate);
+
+  out += "{\"emotion\":";
+  AppendJsonString(out, result.emotion);
+  out += ",\"event\":";
+  AppendJsonString(out, result.event);
+  out += ",\"lang\":";
+  AppendJsonString(out, result.lang);
+  out += is_no_audio ? ",\"status\":\"no_audio\"" : ",\"status\":\"normal\"";
+  out += ",\"text\":";
+  AppendJsonString(out, is_no_audio ? std::string_view() : std::string_view(result.text));
+  if (timings != nullptr) {
+    AppendTimingsJson(out, *timings);
+  }
+
+  out += ",\"timestamps\":[";
+  if (!is_no_audio) {
+    for (size_t i = 0; i < result.timestamps.size(); ++i) {
+      if (i > 0) out.push_back(',');
+      AppendRounded(out, result.timestamps[i]);
+    }
+  }
+  out += "],\"tokens\":[";
+  if (!is_no_audio) {
+    for (size_t i = 0; i < result.tokens.size(); ++i) {
+      if (i > 0) out.push_back(',');
+      AppendJsonString(out, result.tokens[i]);
+    }
+  }
+  out += "]}";
+  return out;
+}
+
+void InsertTimings(std::string &body, const StageTimings &timings) {
+  // Strings in the body have their quotes escaped, so the first unescaped key match is the timestamps key
+  const size_t position = body.find(",\"timestamps\":[");
+  if (position == std::string::npos) return;
+  std::string field;
+  AppendTimingsJson(field, timings);
+  body.insert(position, field);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "sherpa-onnx/c-api/cxx-api.h"
+
+// Time spent in each stage of an /asr request. Stages a request skipped stay zero.
+struct StageTimings {
+  std::chrono::steady_clock::duration parse{};
+  std::chrono::steady_clock::duration decode{};
+  std::chrono::steady_clock::duration queue{};
+  std::chrono::steady_clock::duration infer{};
+  std::chrono::steady_clock::duration serialize{};
+  std::chrono::steady_clock::duration total{};
+};
+
+double Milliseconds(std::chrono::steady_clock::duration duration);
+
+// Formats the stages a request went through as a Server-Timing header value, e.g. `parse;dur=0.312, total;dur=0.540`.
+std::string ServerTimingHeader(const StageTimings &timings);
+
+// Appends `value` as a JSON string literal, escaping like nlohmann::json::dump(). Invalid UTF-8 is replaced with
+// U+FFFD the way dump() does with error_handler_t::replace, so a bad token cannot produce an invalid body.
+void AppendJsonString(std::string &out, std::string_view value);
+
+// Serializes a recognition result into the /asr response body straight from the shared result, without copying it
+// into an intermediate json object. Keys are in sorted order like nlohmann::json::dump(), `timings` is only added
+// when given. The body is allocated once for typical results.
+std::string SerializeResult(const sherpa_onnx::cxx::OfflineRecognizerResult &result, bool is_no_audio,
+                            const StageTimings *timings = nullptr);
+
+// Adds the `timings` field to a body that SerializeResult produced without it, such as a cached one. The result is
+// the same as serializing with `timings` given.
+void InsertTimings(std::string &body, const StageTimings &timings);
@@ -0,0 +1,74 @@
+#include "result_cache.h"
+
+using std::mutex;
+
+// Approximate footprint of an entry: payload plus list node and index bucket overhead.
+size_t ResultCache::entrySize(const Entry &entry) { return sizeof(Entry) + entry.value.capacity() + 64; }
+
+std::optional<std::string> ResultCache::get(uint64_t key, uint64_t check) {
+  std::lock_guard<mutex> lock(mutex_);
+  if (capacity_bytes_ == 0) return std::nullopt;
+
+  auto it = index_.find(key);
+  if (it == index_.end() || it->second->check != check) {
+    ++misses_;
+    return std::nullopt;
+  }
+
+  ++hits_;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->value;
+}
+
+void ResultCache::put(uint64_t key, uint64_t check, const std::string &value) {
+  std::lock_guard<mutex> lock(mutex_);
+  if (capacity_bytes_ == 0) return;
+
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    bytes_ -= entrySize(*it->second);
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+
+  lru_.push_front(Entry{key, check, value});
+  index_[key] = lru_.begin();
+  bytes_ += entrySize(lru_.front());
+
+  evictToCapacity();
+}
+
+void ResultCache::clear() {
+  std::lock_guard<mutex> lock(mutex_);
+  lru_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+void ResultCache::setCapacity(size_t capacity_bytes) {
+  std::lock_guard<mutex> lock(mutex_);
+  capacity_bytes_ = capacity_bytes;
+  evictToCapacity();
+}
+
+void ResultCache::evictToCapacity() {
+  while (bytes_ > capacity_bytes_ && !lru_.empty()) {
+    const Entry &victim = lru_.back();
+    bytes_ -= entrySize(victim);
+    index_.erase(victim.key);
+    lru_.pop_back();
+    ++evictions_;
+  }
+}
+
+ResultCacheStats ResultCache::getStats() const {
+  std::lock_guard<mutex> lock(mutex_);
+  ResultCacheStats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.entries = lru_.size();
+  stats.bytes = bytes_;
+  stats.capacity_bytes = capacity_bytes_;
+  return stats;
+}
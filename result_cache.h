@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+struct ResultCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  size_t entries = 0;
+  size_t bytes = 0;
+  size_t capacity_bytes = 0;
+};
+
+// Bounded LRU cache of serialized /asr responses, keyed by a content hash of the upload and its settings.
+// A capacity of 0 disables the cache.
+//
+// Each entry also stores `check`, a second hash of the upload computed independently of the key. A lookup whose
+// check differs is a key collision and counts as a miss, so a stored response is never returned for another upload.
+class ResultCache {
+ public:
+  explicit ResultCache(size_t capacity_bytes) : capacity_bytes_(capacity_bytes) {}
+
+  std::optional<std::string> get(uint64_t key, uint64_t check);
+  // Stores `value`, replacing any entry under `key`, also one with a different check.
+  void put(uint64_t key, uint64_t check, const std::string &value);
+  void clear();
+  // Changes the memory cap, evicting least recently used entries if the cache is now over it.
+  void setCapacity(size_t capacity_bytes);
+
+  ResultCacheStats getStats() const;
+
+ private:
+  struct Entry {
+    uint64_t key;
+    uint64_t check;
+    std::string value;
+  };
+
+  static size_t entrySize(const Entry &entry);
+  void evictToCapacity();
+
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_;  // Most recently used first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+  size_t capacity_bytes_;
+  size_t bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
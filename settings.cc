@@ -0,0 +1,108 @@
+#include "settings.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Throws unless `condition` holds for the value of `key`.
+static void Require(bool condition, const std::string &key, const std::string &requirement) {
+  if (!condition) {
+    throw std::invalid_argument("Invalid " + key + ": " + requirement);
+  }
+}
+
+// Splits a comma-separated list, dropping surrounding spaces and empty items.
+static std::vector<std::string> SplitList(const std::string &value) {
+  std::vector<std::string> items;
+  std::stringstream stream(value);
+  for (std::string item; std::getline(stream, item, ',');) {
+    const size_t begin = item.find_first_not_of(' ');
+    if (begin == std::string::npos) continue;
+    items.push_back(item.substr(begin, item.find_last_not_of(' ') - begin + 1));
+  }
+  return items;
+}
+
+Settings Settings::FromConfig(const Config &config) {
+  Settings settings;
+
+  settings.default_options.language = config.get<std::string>("MODEL_LANGUAGE");
+  settings.default_options.use_itn = config.get<bool>("MODEL_USE_ITN");
+  Require(IsSupportedLanguage(settings.default_options.language), "MODEL_LANGUAGE", "unsupported language");
+
+  auto languages = SplitList(config.get<std::string>("MODEL_LANGUAGES", ""));
+  languages.insert(languages.begin(), settings.default_options.language);
+  const bool itn_selectable = config.get<bool>("MODEL_ITN_SELECTABLE", false);
+  for (const auto &language : languages) {
+    Require(IsSupportedLanguage(language), "MODEL_LANGUAGES", "unsupported language " + language);
+    for (bool use_itn : {settings.default_options.use_itn, !settings.default_options.use_itn}) {
+      if (use_itn != settings.default_options.use_itn && !itn_selectable) continue;
+      RecognitionOptions options;
+      options.language = language;
+      options.use_itn = use_itn;
+      if (!settings.isLoaded(options)) settings.model_options.push_back(options);
+    }
+  }
+
+  const auto audio_resample_rate = config.get<int32_t>("AUDIO_RESAMPLE_RATE");
+  const auto max_processing_time = config.get<int32_t>("MAX_PROCESSING_TIME");
+  const auto max_queue_capacity = config.get<int32_t>("MAX_QUEUE_CAPACITY");
+  const auto readiness_queue_threshold = config.get<int32_t>("READINESS_QUEUE_THRESHOLD", max_queue_capacity);
+  const auto worker_stall_timeout = config.get<int32_t>("WORKER_STALL_TIMEOUT", 3 * max_processing_time);
+  Require(audio_resample_rate > 0, "AUDIO_RESAMPLE_RATE", "must be positive");
+  Require(max_processing_time > 0, "MAX_PROCESSING_TIME", "must be positive");
+  Require(max_queue_capacity > 0, "MAX_QUEUE_CAPACITY", "must be positive");
+  Require(readiness_queue_threshold > 0, "READINESS_QUEUE_THRESHOLD", "must be positive");
+  Require(worker_stall_timeout > 0, "WORKER_STALL_TIMEOUT", "must be positive");
+  settings.audio_resample_rate = audio_resample_rate;
+  settings.max_processing_time = std::chrono::seconds(max_processing_time);
+  settings.max_queue_capacity = max_queue_capacity;
+  settings.readiness_queue_threshold = readiness_queue_threshold;
+  settings.worker_stall_timeout = std::chrono::seconds(worker_stall_timeout);
+
+  const auto num_workers = config.get<int32_t>("NUM_WORKERS", 1);
+  const auto max_batch_size = config.get<int32_t>("MAX_BATCH_SIZE", 1);
+  settings.result_cache_max_bytes = config.get<int64_t>("RESULT_CACHE_MAX_BYTES", 0);
+  Require(num_workers > 0, "NUM_WORKERS", "must be positive");
+  Require(max_batch_size > 0, "MAX_BATCH_SIZE", "must be positive");
+  Require(settings.result_cache_max_bytes >= 0, "RESULT_CACHE_MAX_BYTES", "must not be negative");
+  settings.num_workers = num_workers;
+  settings.max_batch_size = max_batch_size;
+
+  settings.fast_model = !config.get<std::string>("MODEL_WEIGHTS_FAST_LOCAL", "").empty();
+  settings.fast_model_max_duration = config.get<float>("FAST_MODEL_MAX_DURATION", 2.0f);
+  const auto fast_model_queue_threshold = config.get<int32_t>("FAST_MODEL_QUEUE_THRESHOLD", max_queue_capacity / 2);
+  const auto fast_model_overflow_capacity = config.get<int32_t>("FAST_MODEL_OVERFLOW_CAPACITY", max_queue_capacity);
+  Require(settings.fast_model_max_duration >= 0, "FAST_MODEL_MAX_DURATION", "must not be negative");
+  Require(fast_model_queue_threshold >= 0, "FAST_MODEL_QUEUE_THRESHOLD", "must not be negative");
+  Require(fast_model_overflow_capacity >= 0, "FAST_MODEL_OVERFLOW_CAPACITY", "must not be negative");
+  settings.fast_model_queue_threshold = fast_model_queue_threshold;
+  settings.fast_model_overflow_capacity = fast_model_overflow_capacity;
+
+  const auto log_level = ParseLogLevel(config.get<std::string>("LOG_LEVEL", "info"));
+  Require(log_level.has_value(), "LOG_LEVEL", "must be debug, info, warning or error");
+  settings.log_level = *log_level;
+  settings.trace_enabled = config.get<bool>("TRACE_ENABLED", false);
+
+  settings.silence_detection = config.get<bool>("SILENCE_DETECTION", true);
+  settings.silence_threshold_dbfs = config.get<float>("SILENCE_THRESHOLD_DBFS", -50.0f);
+  const auto silence_min_voiced_ms = config.get<int32_t>("SILENCE_MIN_VOICED_MS", 100);
+  Require(settings.silence_threshold_dbfs <= 0, "SILENCE_THRESHOLD_DBFS", "must not be above 0 dBFS");
+  Require(silence_min_voiced_ms >= 0, "SILENCE_MIN_VOICED_MS", "must not be negative");
+  settings.silence_min_voiced_seconds = silence_min_voiced_ms / 1000.0f;
+
+  return settings;
+}
+
+void SettingsStore::update(Settings settings) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  versions_.push_back(std::make_unique<const Settings>(std::move(settings)));
+  current_.store(versions_.back().get(), std::memory_order_release);
+}
+
+bool Settings::isLoaded(const RecognitionOptions &options) const {
+  return std::any_of(model_options.begin(), model_options.end(), [&](const RecognitionOptions &loaded) {
+    return loaded.language == options.language && loaded.use_itn == options.use_itn;
+  });
+}
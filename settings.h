@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "config.h"
+#include "logger.h"
+#include "recognizer.h"
+
+// Typed, validated operational settings. They are parsed once from Config so that the request path reads plain
+// fields instead of taking Config's mutex and re-parsing strings on every lookup.
+struct Settings {
+  RecognitionOptions default_options;  // MODEL_LANGUAGE and MODEL_USE_ITN
+  // Language and ITN combinations requests may select, one model instance each: every language of MODEL_LANGUAGES
+  // plus MODEL_LANGUAGE, with MODEL_USE_ITN or with both ITN settings if MODEL_ITN_SELECTABLE is on. Fixed at
+  // startup, since the recognizers are loaded for exactly these.
+  std::vector<RecognitionOptions> model_options;
+  int32_t audio_resample_rate = 16000;
+  std::chrono::seconds max_processing_time{10};
+  size_t max_queue_capacity = 100;
+  size_t readiness_queue_threshold = 100;
+  std::chrono::seconds worker_stall_timeout{30};
+
+  size_t num_workers = 1;
+  size_t max_batch_size = 1;
+  int64_t result_cache_max_bytes = 0;
+
+  bool fast_model = false;  // MODEL_WEIGHTS_FAST_LOCAL is set
+  float fast_model_max_duration = 2.0f;
+  size_t fast_model_queue_threshold = 50;
+  size_t fast_model_overflow_capacity = 100;
+
+  LogLevel log_level = LogLevel::kInfo;
+  bool trace_enabled = false;
+
+  bool silence_detection = true;
+  float silence_threshold_dbfs = -50.0f;
+  float silence_min_voiced_seconds = 0.1f;
+
+  // Reads every key with its default, throws std::invalid_argument naming the key if a value is out of range.
+  static Settings FromConfig(const Config &config);
+
+  // Whether `options` selects one of the loaded language and ITN combinations.
+  bool isLoaded(const RecognitionOptions &options) const;
+};
+
+// Publishes the current Settings snapshot. Readers load a pointer to an immutable snapshot without locking;
+// update() swaps in a new one. Replaced snapshots are kept until the store is destroyed, since requests may still
+// be reading them, which is cheap because updates are rare.
+class SettingsStore {
+ public:
+  explicit SettingsStore(Settings settings) { update(std::move(settings)); }
+
+  const Settings &get() const { return *current_.load(std::memory_order_acquire); }
+  void update(Settings settings);
+
+ private:
+  std::atomic<const Settings *> current_{nullptr};
+  std::vector<std::unique_ptr<const Settings>> versions_;
+  std::mutex mutex_;  // Serializes writers only
+};
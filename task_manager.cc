@@ -1,17 +1,32 @@
+#include <stdexcept>
+#include <string>
+
 #include "task_manager.h"
 
-using sherpa_onnx::cxx::OfflineRecognizerResult;
-using std::future;
+#include "logger.h"
+#include "trace.h"
+
 using std::mutex;
+using std::shared_future;
 
-future<OfflineRecognizerResult> RecognitionTaskManager::submitTask(AudioData input, int priority) {
+shared_future<RecognitionResult> RecognitionTaskManager::submitTask(AudioData input, const RecognitionOptions &options,
+                                                                    int priority, std::optional<uint64_t> key) {
   RecognitionTask task;
   task.input = std::move(input);
+  task.options = options;
   task.priority = priority;
-  auto future = task.promise.get_future();
+  task.key = key;
+  task.request_id = CurrentRequestId();
+  shared_future<RecognitionResult> future = task.promise.get_future().share();
 
   {
     std::lock_guard<mutex> lock(mutex_);
+    if (key.has_value()) {
+      auto [it, inserted] = inFlight_.try_emplace(*key, future);
+      if (!inserted) return it->second;
+    }
+    task.sequence = nextSequence_++;
+    task.enqueued_at = std::chrono::steady_clock::now();
     taskQueue_.push(std::move(task));
   }
   cv_.notify_one();
@@ -19,26 +34,142 @@ future<OfflineRecognizerResult> RecognitionTaskManager::submitTask(AudioData inp
   return future;
 }
 
+std::optional<shared_future<RecognitionResult>> RecognitionTaskManager::findTask(uint64_t key) const {
+  std::lock_guard<mutex> lock(mutex_);
+  auto it = inFlight_.find(key);
+  if (it == inFlight_.end()) return std::nullopt;
+  return it->second;
+}
+
 size_t RecognitionTaskManager::getQueueSize() const {
   std::lock_guard<mutex> lock(mutex_);
   return taskQueue_.size();
 }
 
-void RecognitionTaskManager::processTasks() {
+size_t RecognitionTaskManager::getWorkerCount() const {
+  std::lock_guard<mutex> lock(workersMutex_);
+  return workers_.size();
+}
+
+void RecognitionTaskManager::startWorker() {
+  std::lock_guard<mutex> lock(workersMutex_);
+  auto worker = std::make_unique<Worker>();
+  worker->thread = std::thread(&RecognitionTaskManager::processTasks, this, worker.get());
+  workers_.push_back(std::move(worker));
+}
+
+void RecognitionTaskManager::setWorkerCount(size_t num_workers) {
+  num_workers = std::max<size_t>(num_workers, 1);
+
+  std::vector<std::unique_ptr<Worker>> retired;
+  {
+    std::lock_guard<mutex> workers_lock(workersMutex_);
+    if (workers_.size() > num_workers) {
+      std::lock_guard<mutex> lock(mutex_);
+      for (size_t i = num_workers; i < workers_.size(); ++i) {
+        workers_[i]->retiring = true;
+      }
+      retired.insert(retired.end(), std::make_move_iterator(workers_.begin() + num_workers),
+                     std::make_move_iterator(workers_.end()));
+      workers_.resize(num_workers);
+    }
+  }
+  cv_.notify_all();
+  for (auto &worker : retired) {
+    worker->thread.join();
+  }
+
+  while (getWorkerCount() < num_workers) {
+    startWorker();
+  }
+}
+
+void RecognitionTaskManager::setMaxBatchSize(size_t max_batch_size) {
+  std::lock_guard<mutex> lock(mutex_);
+  maxBatchSize_ = std::max<size_t>(max_batch_size, 1);
+}
+
+void RecognitionTaskManager::setProcessor(const RecognitionTaskFn &fn) {
+  auto processor = std::make_shared<const RecognitionTaskFn>(fn);
+  std::lock_guard<mutex> lock(mutex_);
+  recognitionTaskProcessor_.swap(processor);
+}
+
+bool RecognitionTaskManager::isHealthy(std::chrono::steady_clock::duration stall_limit) const {
+  if (!running_) return false;
+
+  std::lock_guard<mutex> lock(workersMutex_);
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  for (const auto &worker : workers_) {
+    const int64_t busy_since = worker->busy_since.load(std::memory_order_relaxed);
+    if (busy_since != 0 && now - busy_since > stall_limit.count()) return false;
+  }
+  return true;
+}
+
+void RecognitionTaskManager::processTasks(Worker *worker) {
+  SetTraceThreadName("worker");
   while (true) {
-    RecognitionTask task;
+    std::vector<RecognitionTask> batch;
+    std::shared_ptr<const RecognitionTaskFn> processor;
+    // Only read the clock for the idle and dequeue spans while tracing
+    const bool tracing = IsTracing();
+    std::chrono::steady_clock::time_point idle_begin, dequeue_begin;
+    if (tracing) idle_begin = std::chrono::steady_clock::now();
     {
       std::unique_lock<mutex> lock(mutex_);
-      cv_.wait(lock, [&] { return !taskQueue_.empty() || !running_; });
+      cv_.wait(lock, [&] { return !taskQueue_.empty() || !running_ || worker->retiring; });
 
-      if (!running_ && taskQueue_.empty()) break;
+      if (worker->retiring || (!running_ && taskQueue_.empty())) break;
+      if (tracing) dequeue_begin = std::chrono::steady_clock::now();
+
+      // Take the highest-priority task plus any following ones with the same options, without waiting for more
+      do {
+        batch.push_back(std::move(const_cast<RecognitionTask &>(taskQueue_.top())));
+        taskQueue_.pop();
+      } while (batch.size() < maxBatchSize_ && !taskQueue_.empty() &&
+               taskQueue_.top().options == batch.front().options);
+      processor = recognitionTaskProcessor_;
+    }
 
-      task = std::move(const_cast<RecognitionTask &>(taskQueue_.top()));
-      taskQueue_.pop();
+    std::vector<AudioData> inputs;
+    inputs.reserve(batch.size());
+    for (auto &task : batch) {
+      inputs.push_back(std::move(task.input));
     }
 
-    auto result = recognitionTaskProcessor_(task.input);
+    const auto begin = std::chrono::steady_clock::now();
+    worker->busy_since.store(begin.time_since_epoch().count(), std::memory_order_relaxed);
+    if (tracing) {
+      TraceSpan("idle", idle_begin, dequeue_begin);
+      TraceSpan("dequeue", dequeue_begin, begin, 0, batch.size());
+      for (const auto &task : batch) {
+        TraceRequestSpan("queued", task.request_id, task.enqueued_at, begin);
+      }
+    }
+    try {
+      auto results = (*processor)(inputs, batch.front().options);
+      if (results.size() != batch.size()) {
+        throw std::runtime_error("Recognizer returned " + std::to_string(results.size()) + " results for " +
+                                 std::to_string(batch.size()) + " inputs");
+      }
+      const auto end = std::chrono::steady_clock::now();
+      const auto inference = end - begin;
+      TraceSpan("inference", begin, end, batch.size() == 1 ? batch.front().request_id : 0, batch.size());
+      for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i].promise.set_value(
+          RecognitionResult{std::move(results[i]), begin - batch[i].enqueued_at, inference, batch.size()});
+      }
+    } catch (...) {
+      for (auto &task : batch) {
+        task.promise.set_exception(std::current_exception());
+      }
+    }
+    worker->busy_since.store(0, std::memory_order_relaxed);
 
-    task.promise.set_value(std::move(result));
+    std::lock_guard<mutex> lock(mutex_);
+    for (const auto &task : batch) {
+      if (task.key.has_value()) inFlight_.erase(*task.key);
+    }
   }
 }
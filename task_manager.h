@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -8,45 +9,109 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 #include "audio.h"
+#include "recognizer.h"
 #include "sherpa-onnx/c-api/cxx-api.h"
 
+// A recognition result with the time its task spent waiting in the queue and the time its batch took to decode.
+struct RecognitionResult {
+  sherpa_onnx::cxx::OfflineRecognizerResult result;
+  std::chrono::steady_clock::duration queue_wait{};
+  std::chrono::steady_clock::duration inference{};
+  size_t batch_size = 0;
+};
+
 struct RecognitionTask {
   int32_t priority;
-  std::promise<sherpa_onnx::cxx::OfflineRecognizerResult> promise;
+  uint64_t sequence;  // Submission order, keeps tasks of equal priority first-in first-out
+  std::chrono::steady_clock::time_point enqueued_at;
+  std::promise<RecognitionResult> promise;
   AudioData input;
+  RecognitionOptions options;
+  std::optional<uint64_t> key;  // Content key used to coalesce identical submissions
+  uint64_t request_id = 0;      // Request that submitted the task, for tracing
 
-  bool operator<(const RecognitionTask &other) const { return priority < other.priority; }
+  bool operator<(const RecognitionTask &other) const {
+    if (priority != other.priority) return priority < other.priority;
+    return sequence > other.sequence;
+  }
 };
 
-using RecognitionTaskFn = std::function<sherpa_onnx::cxx::OfflineRecognizerResult(const AudioData &)>;
+// Recognizes a batch of clips that share the same options, returning one result per clip in order.
+using RecognitionTaskFn = std::function<std::vector<sherpa_onnx::cxx::OfflineRecognizerResult>(
+  const std::vector<AudioData> &, const RecognitionOptions &)>;
 
 class RecognitionTaskManager {
  public:
-  RecognitionTaskManager(const RecognitionTaskFn &fn)
-      : running_(true), worker_(&RecognitionTaskManager::processTasks, this), recognitionTaskProcessor_(fn) {}
+  // Starts `num_workers` threads that call `fn` concurrently. The function must be thread-safe; a shared
+  // Recognizer is, since ONNX Runtime sessions allow concurrent runs. Each call receives up to `max_batch_size`
+  // queued tasks with the same options.
+  RecognitionTaskManager(const RecognitionTaskFn &fn, size_t num_workers = 1, size_t max_batch_size = 1)
+      : running_(true),
+        maxBatchSize_(std::max<size_t>(max_batch_size, 1)),
+        recognitionTaskProcessor_(std::make_shared<const RecognitionTaskFn>(fn)) {
+    for (size_t i = 0; i < std::max<size_t>(num_workers, 1); ++i) {
+      startWorker();
+    }
+  }
 
   ~RecognitionTaskManager() {
     {
       std::lock_guard<std::mutex> lock(mutex_);
       running_ = false;
     }
-    cv_.notify_one();
-    if (worker_.joinable()) worker_.join();
+    cv_.notify_all();
+    for (auto &worker : workers_) {
+      if (worker->thread.joinable()) worker->thread.join();
+    }
   }
 
-  std::future<sherpa_onnx::cxx::OfflineRecognizerResult> submitTask(AudioData input, int priority = 0);
+  // Queues a task. If `key` is given and a task with the same key is still queued or running,
+  // no new work is created and the future of that task is returned instead.
+  std::shared_future<RecognitionResult> submitTask(AudioData input, const RecognitionOptions &options, int priority = 0,
+                                                  std::optional<uint64_t> key = std::nullopt);
+
+  // Returns the future of the queued or running task with this key, if any.
+  std::optional<std::shared_future<RecognitionResult>> findTask(uint64_t key) const;
 
   size_t getQueueSize() const;
+  size_t getWorkerCount() const;
+
+  // Starts or stops workers until `num_workers` are running. Stopped workers finish their current batch first,
+  // this call returns once they have exited. Queued tasks are kept.
+  void setWorkerCount(size_t num_workers);
+  void setMaxBatchSize(size_t max_batch_size);
+
+  // Replaces the processing function. Tasks already running finish with the previous function, which is
+  // released (together with anything it captured) once the last of them completes.
+  void setProcessor(const RecognitionTaskFn &fn);
+
+  // False once any worker has been busy with a single task for longer than `stall_limit`.
+  bool isHealthy(std::chrono::steady_clock::duration stall_limit) const;
 
  private:
-  void processTasks();
+  struct Worker {
+    std::thread thread;
+    std::atomic<int64_t> busy_since{0};  // steady_clock ticks when the current task started, 0 while idle
+    bool retiring = false;               // Set under mutex_ to make the worker exit, see setWorkerCount()
+  };
+
+  void startWorker();
+  void processTasks(Worker *worker);
 
   mutable std::mutex mutex_;
   std::condition_variable cv_;
   std::priority_queue<RecognitionTask> taskQueue_;
+  std::unordered_map<uint64_t, std::shared_future<RecognitionResult>> inFlight_;
+  uint64_t nextSequence_ = 0;
   std::atomic<bool> running_;
-  std::thread worker_;
-  RecognitionTaskFn recognitionTaskProcessor_;
+  size_t maxBatchSize_;
+  std::shared_ptr<const RecognitionTaskFn> recognitionTaskProcessor_;
+  mutable std::mutex workersMutex_;  // Guards workers_, separate from mutex_ so that joins do not block the queue
+  std::vector<std::unique_ptr<Worker>> workers_;
 };
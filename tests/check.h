@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the test executables, which have no framework dependency. A failed check prints its
+// location and the test keeps going; main() returns TestExitCode() so that ctest reports the failure.
+inline int &TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                                   \
+  do {                                                                                     \
+    if (!(condition)) {                                                                    \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+      ++TestFailures();                                                                    \
+    }                                                                                      \
+  } while (false)
+
+#define CHECK_EQ(actual, expected)                                                                      \
+  do {                                                                                                  \
+    if (!((actual) == (expected))) {                                                                    \
+      std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #actual, #expected); \
+      ++TestFailures();                                                                                 \
+    }                                                                                                   \
+  } while (false)
+
+// Runs one test function and prints whether it passed.
+#define RUN_TEST(test)                                                                            \
+  do {                                                                                            \
+    const int failures_before = TestFailures();                                                   \
+    test();                                                                                       \
+    std::fprintf(stderr, "%s %s\n", TestFailures() == failures_before ? "PASS" : "FAIL", #test); \
+  } while (false)
+
+inline int TestExitCode() { return TestFailures() == 0 ? 0 : 1; }
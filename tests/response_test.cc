@@ -0,0 +1,168 @@
+// /asr response serialization: byte-for-byte agreement with the nlohmann::json body it replaced, and the number of
+// heap allocations per response. Global operator new is replaced to count allocations.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "response.h"
+
+using sherpa_onnx::cxx::OfflineRecognizerResult;
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+  ++allocations;
+  if (void *p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// The body as the original handler built it: an nlohmann::json object with timestamps rounded to 2 decimal places.
+// The replace handler stands in for the default strict one, which throws on invalid UTF-8.
+static std::string ReferenceBody(const OfflineRecognizerResult &result, bool is_no_audio) {
+  nlohmann::json timestamps = nlohmann::json::array();
+  if (!is_no_audio) {
+    for (float num : result.timestamps) {
+      timestamps.push_back(static_cast<int>(num * 100 + (num >= 0 ? 0.5 : -0.5)) / 100.0);
+    }
+  }
+  nlohmann::json body = {
+    {"status", is_no_audio ? "no_audio" : "normal"},
+    {"lang", result.lang},
+    {"emotion", result.emotion},
+    {"event", result.event},
+    {"text", is_no_audio ? std::string() : result.text},
+    {"timestamps", timestamps},
+    {"tokens", is_no_audio ? std::vector<std::string>() : result.tokens},
+  };
+  return body.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+static OfflineRecognizerResult MakeResult(const std::vector<std::string> &tokens) {
+  OfflineRecognizerResult result;
+  result.lang = "<|zh|>";
+  result.emotion = "<|NEUTRAL|>";
+  result.event = "<|Speech|>";
+  result.tokens = tokens;
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    result.text += tokens[i];
+    result.timestamps.push_back(0.06f * i);
+  }
+  return result;
+}
+
+// A typical transcript: 60 Chinese characters and punctuation, timestamps up to 3.5 s.
+static OfflineRecognizerResult TypicalResult() {
+  const std::vector<std::string> pieces = {"今", "天", "天", "气", "很", "好", "，"};
+  std::vector<std::string> tokens;
+  for (size_t i = 0; i < 60; ++i) tokens.push_back(pieces[i % pieces.size()]);
+  return MakeResult(tokens);
+}
+
+static void TestMatchesNlohmannDump() {
+  const std::vector<OfflineRecognizerResult> results = {
+    TypicalResult(),
+    MakeResult({"hello", " world", "."}),
+    MakeResult({}),
+    // Characters nlohmann escapes: quotes, backslashes, short escapes and other control characters
+    MakeResult({"\"quoted\"", "back\\slash", "\b\f\n\r\t", std::string("\x00\x01\x1f", 3), "\x7f", "/"}),
+    // Multi-byte UTF-8 up to 4 bytes, including the boundaries of the valid ranges
+    MakeResult({"\u00e9", "\u07ff", "\u0800", "\ud7ff", "\ue000", "\uffff", "\U00010000", "\U0010ffff",
+                "\U0001f600"}),
+    // Invalid UTF-8: stray continuation, bad lead bytes, overlong forms, surrogates, above U+10FFFF, cut off
+    MakeResult({"\x80", "a\xbf" "b", "\xc0\xaf", "\xc1\xbf", "\xc3\x28", "\xe0\x80\xaf", "\xed\xa0\x80",
+                "\xf4\x90\x80\x80", "\xf5\x80", "\xff", "\xe2\x82", "\xf0\x9f\x98", "ok\xe2\x82\xac", "\xe2\x28\xa1",
+                "\xf0\x28\x8c\xbc"}),
+  };
+  for (const auto &result : results) {
+    CHECK_EQ(SerializeResult(result, false), ReferenceBody(result, false));
+    CHECK_EQ(SerializeResult(result, true), ReferenceBody(result, true));
+  }
+}
+
+static void TestRoundingMatchesNlohmannDump() {
+  const std::vector<float> values = {0.0f,  0.004f,   0.005f,  0.015f,  0.125f, 0.1f,   0.29f,    0.3f,
+                                     1.0f,  1.5f,     2.675f,  9.995f,  12.34f, 59.999f, 123.456f, 1000.0f,
+                                     0.07f, 3599.99f, 86400.0f, -0.001f, -0.005f, -1.25f, 1e-7f};
+  for (float value : values) {
+    OfflineRecognizerResult result;
+    result.timestamps = {value};
+    result.tokens = {"x"};
+    CHECK_EQ(SerializeResult(result, false), ReferenceBody(result, false));
+  }
+}
+
+// The timings field sits between text and timestamps, and the rest of the body is unchanged.
+static void TestTimingsField() {
+  const auto result = TypicalResult();
+  StageTimings timings;
+  timings.parse = std::chrono::microseconds(1500);
+  timings.total = std::chrono::milliseconds(42);
+
+  const auto body = nlohmann::json::parse(SerializeResult(result, false, &timings));
+  CHECK_EQ(body["timings"]["parse_ms"].get<double>(), 1.5);
+  CHECK_EQ(body["timings"]["total_ms"].get<double>(), 42.0);
+  CHECK_EQ(body["timings"]["infer_ms"].get<double>(), 0.0);
+  auto without_timings = body;
+  without_timings.erase("timings");
+  CHECK_EQ(without_timings.dump(), ReferenceBody(result, false));
+}
+
+// Splicing timings into a cached body gives the same bytes as serializing with them, even when the text contains
+// what looks like the timestamps key.
+static void TestInsertTimings() {
+  StageTimings timings;
+  timings.decode = std::chrono::microseconds(2500);
+  timings.total = std::chrono::milliseconds(7);
+  for (const auto &result : {TypicalResult(), MakeResult({",\"timestamps\":[", "x"}), MakeResult({})}) {
+    for (bool is_no_audio : {false, true}) {
+      auto body = SerializeResult(result, is_no_audio);
+      InsertTimings(body, timings);
+      CHECK_EQ(body, SerializeResult(result, is_no_audio, &timings));
+    }
+  }
+}
+
+// Counts the heap allocations of `fn`.
+template <typename Fn>
+static size_t CountAllocations(Fn fn) {
+  const size_t before = allocations.load();
+  fn();
+  return allocations.load() - before;
+}
+
+// A response body takes one allocation, sized up front, with or without timings and for no_audio.
+static void TestSerializeAllocatesOnce() {
+  const auto result = TypicalResult();
+  StageTimings timings;
+  timings.total = std::chrono::milliseconds(120);
+
+  CHECK_EQ(CountAllocations([&] { SerializeResult(result, false); }), 1u);
+  CHECK_EQ(CountAllocations([&] { SerializeResult(result, false, &timings); }), 1u);
+  CHECK_EQ(CountAllocations([&] { SerializeResult(result, true); }), 1u);
+
+  // The path it replaced copied the result and built a json tree, for comparison in the test output
+  const size_t reference = CountAllocations([&] {
+    auto copy = result;
+    ReferenceBody(copy, false);
+  });
+  std::fprintf(stderr, "allocations per response: %zu, previously %zu\n",
+               CountAllocations([&] { SerializeResult(result, false); }), reference);
+  CHECK(reference > 1);
+}
+
+int main() {
+  RUN_TEST(TestMatchesNlohmannDump);
+  RUN_TEST(TestRoundingMatchesNlohmannDump);
+  RUN_TEST(TestTimingsField);
+  RUN_TEST(TestInsertTimings);
+  RUN_TEST(TestSerializeAllocatesOnce);
+  return TestExitCode();
+}
@@ -0,0 +1,35 @@
+// ResultCache lookups: a key collision, i.e. the same key with another check, must never return the stored response.
+
+#include <string>
+
+#include "check.h"
+#include "result_cache.h"
+
+// A lookup with the key of a stored entry but another check misses and is counted as one.
+static void TestCollisionIsAMiss() {
+  ResultCache cache(1 << 20);
+  cache.put(1, 100, "first");
+
+  CHECK(cache.get(1, 200) == std::nullopt);
+  CHECK(cache.get(1, 100) == std::optional<std::string>("first"));
+  const auto stats = cache.getStats();
+  CHECK_EQ(stats.hits, 1u);
+  CHECK_EQ(stats.misses, 1u);
+}
+
+// Storing a colliding upload replaces the entry, and the earlier upload then misses.
+static void TestCollidingPutReplaces() {
+  ResultCache cache(1 << 20);
+  cache.put(1, 100, "first");
+  cache.put(1, 200, "second");
+
+  CHECK(cache.get(1, 100) == std::nullopt);
+  CHECK(cache.get(1, 200) == std::optional<std::string>("second"));
+  CHECK_EQ(cache.getStats().entries, 1u);
+}
+
+int main() {
+  RUN_TEST(TestCollisionIsAMiss);
+  RUN_TEST(TestCollidingPutReplaces);
+  return TestExitCode();
+}
@@ -0,0 +1,270 @@
+// Batching behavior of RecognitionTaskManager, run against model-free task functions.
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "mock_recognizer.h"
+#include "task_manager.h"
+
+using sherpa_onnx::cxx::OfflineRecognizerResult;
+
+// A clip of `length` samples, so that results can name the clip they belong to.
+static AudioData Clip(size_t length) {
+  AudioData wave;
+  wave.samples.assign(length, 0.0f);
+  wave.sample_rate = 16000;
+  wave.channels = 1;
+  return wave;
+}
+
+static RecognitionOptions Options(const std::string &language, bool use_itn = false) {
+  RecognitionOptions options;
+  options.language = language;
+  options.use_itn = use_itn;
+  return options;
+}
+
+// Task function that records every batch it gets and answers each clip with its length as text. Calls block until
+// open() so that tests can queue tasks behind a running one and control what is waiting when the worker returns.
+class GatedRecorder {
+ public:
+  struct Batch {
+    RecognitionOptions options;
+    std::vector<size_t> lengths;
+  };
+
+  RecognitionTaskFn fn(bool fail = false) {
+    return [this, fail](const std::vector<AudioData> &waves, const RecognitionOptions &options) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++calls_;
+      cv_.notify_all();
+      cv_.wait(lock, [this] { return open_; });
+
+      Batch batch{options, {}};
+      std::vector<OfflineRecognizerResult> results;
+      for (const auto &wave : waves) {
+        batch.lengths.push_back(wave.samples.size());
+        OfflineRecognizerResult result;
+        result.text = std::to_string(wave.samples.size());
+        results.push_back(std::move(result));
+      }
+      batches_.push_back(std::move(batch));
+      if (fail && batches_.size() > 1) throw std::runtime_error("inference failed");
+      return results;
+    };
+  }
+
+  // Waits until the task function has been entered `count` times.
+  void waitForCalls(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return calls_ >= count; });
+  }
+
+  void open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    cv_.notify_all();
+  }
+
+  std::vector<Batch> batches() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return batches_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  size_t calls_ = 0;
+  bool open_ = false;
+  std::vector<Batch> batches_;
+};
+
+// Each clip gets the result computed for it, in submission order within a batch.
+static void TestResultsFollowClips() {
+  GatedRecorder recorder;
+  RecognitionTaskManager manager(recorder.fn(), 1, 8);
+  auto blocker = manager.submitTask(Clip(1), Options("zh"));
+  recorder.waitForCalls(1);
+
+  std::vector<std::shared_future<RecognitionResult>> futures;
+  for (size_t length = 10; length < 16; ++length) {
+    futures.push_back(manager.submitTask(Clip(length), Options("zh")));
+  }
+  recorder.open();
+
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const auto &result = futures[i].get();
+    CHECK_EQ(result.result.text, std::to_string(10 + i));
+    CHECK_EQ(result.batch_size, futures.size());
+  }
+  const auto batches = recorder.batches();
+  CHECK_EQ(batches.size(), 2u);
+  CHECK((batches.back().lengths == std::vector<size_t>{10, 11, 12, 13, 14, 15}));
+}
+
+// A batch never mixes options and never exceeds the maximum batch size.
+static void TestBatchesGroupSameOptionsUpToMaxSize() {
+  GatedRecorder recorder;
+  RecognitionTaskManager manager(recorder.fn(), 1, 3);
+  manager.submitTask(Clip(1), Options("zh"));
+  recorder.waitForCalls(1);
+
+  const std::vector<std::pair<size_t, RecognitionOptions>> tasks = {
+    {2, Options("zh")}, {3, Options("zh")}, {4, Options("zh")}, {5, Options("zh")},
+    {6, Options("en")}, {7, Options("zh", true)}, {8, Options("zh", true)},
+  };
+  std::vector<std::shared_future<RecognitionResult>> futures;
+  for (const auto &[length, options] : tasks) {
+    futures.push_back(manager.submitTask(Clip(length), options));
+  }
+  recorder.open();
+  for (const auto &future : futures) future.wait();
+
+  const auto batches = recorder.batches();
+  // Tasks are taken in submission order: a full batch of three, the one left over, then each run of equal options
+  const std::vector<std::vector<size_t>> expected = {{1}, {2, 3, 4}, {5}, {6}, {7, 8}};
+  CHECK_EQ(batches.size(), expected.size());
+  for (size_t i = 0; i < batches.size() && i < expected.size(); ++i) {
+    CHECK(batches[i].lengths == expected[i]);
+    CHECK(batches[i].lengths.size() <= 3);
+  }
+  for (const auto &batch : batches) {
+    for (size_t length : batch.lengths) {
+      const auto submitted = length == 1 ? Options("zh") : tasks[length - 2].second;
+      CHECK(batch.options == submitted);
+    }
+  }
+}
+
+// An exception from the task function fails every task of the batch and none of the others.
+static void TestExceptionReachesEveryTaskOfTheBatch() {
+  GatedRecorder recorder;
+  RecognitionTaskManager manager(recorder.fn(true), 1, 4);
+  auto first = manager.submitTask(Clip(1), Options("zh"));
+  recorder.waitForCalls(1);
+
+  std::vector<std::shared_future<RecognitionResult>> futures;
+  for (size_t length = 2; length < 5; ++length) {
+    futures.push_back(manager.submitTask(Clip(length), Options("zh")));
+  }
+  recorder.open();
+
+  CHECK_EQ(first.get().result.text, "1");
+  for (const auto &future : futures) {
+    bool threw = false;
+    try {
+      future.get();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    CHECK(threw);
+  }
+  CHECK_EQ(recorder.batches().size(), 2u);
+}
+
+// Whether `key` is dropped from the in-flight tasks within a few seconds. Keys are released right after the
+// batch's promises are set, so a caller that has just seen the result may still find the key for a moment.
+static bool KeyReleased(const RecognitionTaskManager &manager, uint64_t key) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (manager.findTask(key).has_value()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Tasks submitted with the same key while the first is queued share its processor call and result. Once it has
+// finished the key is released, and the next submit runs again.
+static void TestSameKeySharesOneCall() {
+  GatedRecorder recorder;
+  RecognitionTaskManager manager(recorder.fn(), 1, 8);
+  manager.submitTask(Clip(1), Options("zh"));
+  recorder.waitForCalls(1);
+
+  auto first = manager.submitTask(Clip(10), Options("zh"), 0, 7);
+  auto second = manager.submitTask(Clip(11), Options("zh"), 0, 7);
+  CHECK(manager.findTask(7).has_value());
+  CHECK_EQ(manager.getQueueSize(), 1u);
+  recorder.open();
+
+  CHECK_EQ(first.get().result.text, "10");
+  CHECK_EQ(second.get().result.text, "10");
+  CHECK_EQ(recorder.batches().size(), 2u);
+
+  CHECK(KeyReleased(manager, 7));
+  CHECK_EQ(manager.submitTask(Clip(12), Options("zh"), 0, 7).get().result.text, "12");
+  CHECK_EQ(recorder.batches().size(), 3u);
+  CHECK(KeyReleased(manager, 7));
+}
+
+// A key is released when the processor throws too, so a failed upload can be retried.
+static void TestKeyReleasedAfterException() {
+  GatedRecorder recorder;
+  RecognitionTaskManager manager(recorder.fn(true), 1, 8);
+  manager.submitTask(Clip(1), Options("zh"));
+  recorder.waitForCalls(1);
+
+  auto failing = manager.submitTask(Clip(2), Options("zh"), 0, 9);
+  recorder.open();
+  bool threw = false;
+  try {
+    failing.get();
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+
+  CHECK(KeyReleased(manager, 9));
+  manager.submitTask(Clip(3), Options("zh"), 0, 9).wait();
+  CHECK_EQ(recorder.batches().size(), 3u);
+  CHECK(KeyReleased(manager, 9));
+}
+
+// A task function that returns the wrong number of results fails the batch instead of leaving promises unset.
+static void TestResultCountMismatchFailsTheBatch() {
+  RecognitionTaskManager manager(
+    [](const std::vector<AudioData> &, const RecognitionOptions &) { return std::vector<OfflineRecognizerResult>(); });
+  bool threw = false;
+  try {
+    manager.submitTask(Clip(1), Options("zh")).get();
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+// The mock backend through several workers: every clip is answered, in batches of at most the maximum size.
+static void TestMockBackendWithWorkers() {
+  MockRecognizerConfig config;
+  config.rtf = 0;
+  config.overhead_ms = 1;
+  RecognitionTaskManager manager(MakeMockRecognizer(config), 4, 4);
+
+  std::vector<std::shared_future<RecognitionResult>> futures;
+  for (size_t i = 0; i < 50; ++i) {
+    futures.push_back(manager.submitTask(Clip(16000), Options(i % 2 == 0 ? "zh" : "en")));
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const auto &result = futures[i].get();
+    CHECK_EQ(result.result.lang, i % 2 == 0 ? "<|zh|>" : "<|en|>");
+    CHECK(result.batch_size >= 1 && result.batch_size <= 4);
+  }
+}
+
+int main() {
+  RUN_TEST(TestResultsFollowClips);
+  RUN_TEST(TestBatchesGroupSameOptionsUpToMaxSize);
+  RUN_TEST(TestExceptionReachesEveryTaskOfTheBatch);
+  RUN_TEST(TestSameKeySharesOneCall);
+  RUN_TEST(TestKeyReleasedAfterException);
+  RUN_TEST(TestResultCountMismatchFailsTheBatch);
+  RUN_TEST(TestMockBackendWithWorkers);
+  return TestExitCode();
+}
@@ -0,0 +1,153 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+#include "logger.h"
+
+// Thread names beyond this many threads are not recorded, their spans still are.
+constexpr size_t TRACE_MAX_THREADS = 256;
+
+// One buffered span. Fields are written by one thread and may be read by RenderTrace() at the same time, so they
+// are relaxed atomics guarded by `sequence` in the manner of a seqlock.
+struct TraceSlot {
+  std::atomic<uint64_t> sequence{0};  // Event index + 1 once written, 0 while being written
+  std::atomic<const char *> name{nullptr};
+  std::atomic<int64_t> begin_us{0};
+  std::atomic<int64_t> end_us{0};
+  std::atomic<uint64_t> request_id{0};
+  std::atomic<uint32_t> thread{0};  // 0 for spans on a request track
+  std::atomic<uint32_t> batch_size{0};
+};
+
+static std::atomic<bool> tracing{false};
+static std::atomic<TraceSlot *> trace_slots{nullptr};
+static std::atomic<uint64_t> next_event{0};
+static std::atomic<const char *> thread_names[TRACE_MAX_THREADS];
+
+static int64_t Microseconds(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+void SetTracing(bool enabled) {
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (enabled && trace_slots.load(std::memory_order_relaxed) == nullptr) {
+    // Never freed, spans may be written at any time once tracing has been on
+    trace_slots.store(new TraceSlot[TRACE_BUFFER_EVENTS], std::memory_order_release);
+  }
+  tracing.store(enabled, std::memory_order_release);
+}
+
+bool IsTracing() { return tracing.load(std::memory_order_relaxed); }
+
+void SetTraceThreadName(const char *name) {
+  const uint32_t thread = CurrentThreadIndex();
+  if (thread < TRACE_MAX_THREADS) thread_names[thread].store(name, std::memory_order_relaxed);
+}
+
+static void Record(const char *name, uint32_t thread, std::chrono::steady_clock::time_point begin,
+                   std::chrono::steady_clock::time_point end, uint64_t request_id, uint32_t batch_size) {
+  TraceSlot *slots = trace_slots.load(std::memory_order_acquire);
+  if (slots == nullptr) return;
+  const uint64_t index = next_event.fetch_add(1, std::memory_order_relaxed);
+  TraceSlot &slot = slots[index % TRACE_BUFFER_EVENTS];
+
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin_us.store(Microseconds(begin), std::memory_order_relaxed);
+  slot.end_us.store(Microseconds(end), std::memory_order_relaxed);
+  slot.request_id.store(request_id, std::memory_order_relaxed);
+  slot.thread.store(thread, std::memory_order_relaxed);
+  slot.batch_size.store(batch_size, std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void TraceSpan(const char *name, std::chrono::steady_clock::time_point begin,
+               std::chrono::steady_clock::time_point end, uint64_t request_id, uint32_t batch_size) {
+  if (!IsTracing()) return;
+  Record(name, CurrentThreadIndex(), begin, end, request_id, batch_size);
+}
+
+void TraceRequestSpan(const char *name, uint64_t request_id, std::chrono::steady_clock::time_point begin,
+                      std::chrono::steady_clock::time_point end) {
+  if (!IsTracing() || request_id == 0) return;
+  Record(name, 0, begin, end, request_id, 0);
+}
+
+// Appends `,` unless this is the first event.
+static void AppendSeparator(std::string &out, bool &first) {
+  if (!first) out.push_back(',');
+  first = false;
+}
+
+void RenderTrace(std::string &out) {
+  out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  char buf[256];
+
+  for (size_t thread = 1; thread < TRACE_MAX_THREADS; ++thread) {
+    const char *name = thread_names[thread].load(std::memory_order_relaxed);
+    if (name == nullptr) continue;
+    AppendSeparator(out, first);
+    const int n = std::snprintf(buf, sizeof(buf),
+                                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+                                "\"args\":{\"name\":\"%s %zu\"}}",
+                                thread, name, thread);
+    out.append(buf, n);
+  }
+
+  TraceSlot *slots = trace_slots.load(std::memory_order_acquire);
+  if (slots != nullptr) {
+    const uint64_t end = next_event.load(std::memory_order_relaxed);
+    const uint64_t begin = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+    for (uint64_t index = begin; index < end; ++index) {
+      const TraceSlot &slot = slots[index % TRACE_BUFFER_EVENTS];
+      if (slot.sequence.load(std::memory_order_acquire) != index + 1) continue;
+      const char *name = slot.name.load(std::memory_order_relaxed);
+      const int64_t begin_us = slot.begin_us.load(std::memory_order_relaxed);
+      const int64_t end_us = slot.end_us.load(std::memory_order_relaxed);
+      const uint64_t request_id = slot.request_id.load(std::memory_order_relaxed);
+      const uint32_t thread = slot.thread.load(std::memory_order_relaxed);
+      const uint32_t batch_size = slot.batch_size.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != index + 1) continue;  // Overwritten while reading
+
+      const auto id = static_cast<unsigned long long>(request_id);
+      int n;
+      if (thread == 0) {
+        // An async begin/end pair, Perfetto and chrome://tracing draw one track per request ID
+        AppendSeparator(out, first);
+        n = std::snprintf(buf, sizeof(buf),
+                          "{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"b\",\"id\":%llu,\"pid\":1,\"ts\":%lld},"
+                          "{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"e\",\"id\":%llu,\"pid\":1,\"ts\":%lld}",
+                          name, id, static_cast<long long>(begin_us), name, id, static_cast<long long>(end_us));
+        out.append(buf, n);
+        continue;
+      }
+
+      AppendSeparator(out, first);
+      n = std::snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld",
+                        name, thread, static_cast<long long>(begin_us), static_cast<long long>(end_us - begin_us));
+      out.append(buf, n);
+      if (request_id != 0 || batch_size != 0) {
+        out += ",\"args\":{";
+        if (request_id != 0) {
+          n = std::snprintf(buf, sizeof(buf), "\"request_id\":%llu%s", id, batch_size != 0 ? "," : "");
+          out.append(buf, n);
+        }
+        if (batch_size != 0) {
+          n = std::snprintf(buf, sizeof(buf), "\"batch_size\":%u", batch_size);
+          out.append(buf, n);
+        }
+        out.push_back('}');
+      }
+      out.push_back('}');
+    }
+  }
+
+  out += "]}";
+}
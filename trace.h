@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Opt-in recording of request and worker spans in the Chrome trace-event format, viewable in chrome://tracing or
+// ui.perfetto.dev. Spans go into a fixed ring buffer that keeps the most recent TRACE_BUFFER_EVENTS of them.
+// While tracing is off every Trace*() call returns after one relaxed atomic load, and the buffer is only allocated
+// the first time tracing is turned on.
+
+constexpr size_t TRACE_BUFFER_EVENTS = 65536;
+
+void SetTracing(bool enabled);
+bool IsTracing();
+
+// Names the calling thread in the trace, e.g. "worker". `name` must outlive the process, a string literal.
+void SetTraceThreadName(const char *name);
+
+// Records a span on the calling thread. `name` must be a string literal. `request_id` and `batch_size` are shown
+// as arguments of the span unless they are 0.
+void TraceSpan(const char *name, std::chrono::steady_clock::time_point begin,
+               std::chrono::steady_clock::time_point end, uint64_t request_id = 0, uint32_t batch_size = 0);
+
+// Records a span on the track of `request_id` rather than on a thread, for time spent between threads such as
+// waiting in the queue.
+void TraceRequestSpan(const char *name, uint64_t request_id, std::chrono::steady_clock::time_point begin,
+                      std::chrono::steady_clock::time_point end);
+
+// Appends the buffered spans as a trace JSON object, `{"traceEvents":[...]}`. Spans still being written by other
+// threads are skipped.
+void RenderTrace(std::string &out);